@@ -1,12 +1,44 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <utility>
+#include "../ch05/stack/Segmented.h"
 using namespace std;
 
 // 头文件 ===
 class Stack {
 public:
+    // indexed为true时额外维护一个"元素 -> 出现次数"的哈希表，find与count变为O(1)（期望），
+    // 代价是每次push、pop多一次哈希表操作和这张表占用的内存；默认不维护，find与count逐个比较
+    explicit Stack(bool indexed = false) {
+        if (indexed) enable_index();
+    }
+    // 复制时哈希表（如果有）也一起深拷贝，两个栈各自维护自己的表
+    Stack(const Stack &rhs): _stack(rhs._stack) {
+        if (rhs._index) _index.reset(new unordered_map<string, int>(*rhs._index));
+    }
+    Stack& operator=(const Stack &rhs) {
+        if (this != &rhs) {
+            _stack = rhs._stack;
+            _index.reset(rhs._index ? new unordered_map<string, int>(*rhs._index) : nullptr);
+        }
+        return *this;
+    }
+    Stack(Stack &&) = default;
+    Stack& operator=(Stack &&) = default;
+    // 之后再打开也可以：按当前内容建一次表（O(n)），此后随push、pop更新
+    void enable_index();
+    bool indexed() const { return _index != nullptr; }
+
     bool push(const string &);
+    // 右值直接移入栈中，不复制字符串的内容
+    bool push(string &&);
+    // 用参数在栈顶原地构造一个string
+    template <typename... Args>
+    bool emplace(Args&&... args);
+    // 栈顶元素被移动到elem中，而不是复制
     bool pop(string &elem);
     bool peek(string &elem);
     bool empty() const {
@@ -22,7 +54,9 @@ public:
     int count(const string &elem) const;
 
 private:
-    vector<string> _stack;
+    // 分段存储（见ch05/stack/Segmented.h）：增长时不搬动已有的元素
+    SegmentedVector<string> _stack;
+    unique_ptr<unordered_map<string, int> > _index;     // 不维护时为空指针，只占一个指针的空间
 };
 // 头文件结束 ===
 
@@ -31,13 +65,35 @@ private:
 bool Stack::push(const string &elem) {
     if (full()) return false;
     _stack.push_back(elem);
+    if (_index) ++(*_index)[elem];
+    return true;
+}
+
+bool Stack::push(string &&elem) {
+    if (full()) return false;
+    // 先计入索引再移走elem
+    if (_index) ++(*_index)[elem];
+    _stack.push_back(std::move(elem));
+    return true;
+}
+
+template <typename... Args>
+bool Stack::emplace(Args&&... args) {
+    if (full()) return false;
+    const string &elem = _stack.emplace_back(std::forward<Args>(args)...);
+    if (_index) ++(*_index)[elem];
     return true;
 }
 
 bool Stack::pop(string &elem) {
     if (empty()) return false;
-    elem = _stack.back();
+    elem = std::move(_stack.back());
     _stack.pop_back();
+    // 次数减到0的元素从表中删掉，表的大小始终不超过栈中不同元素的个数
+    if (_index) {
+        auto it = _index->find(elem);
+        if (--it->second == 0) _index->erase(it);
+    }
     return true;
 }
 
@@ -47,11 +103,23 @@ bool Stack::peek(string &elem) {
     return true;
 }
 
+void Stack::enable_index() {
+    if (_index) return;
+    _index.reset(new unordered_map<string, int>);
+    _index->reserve(_stack.size());
+    for (const string &elem : _stack) ++(*_index)[elem];
+}
+
 bool Stack::find(const string &elem) const {
+    if (_index) return _index->count(elem) != 0;
     return ::find(_stack.begin(), _stack.end(), elem) != _stack.end();
 }
 
 int Stack::count(const string &elem) const {
+    if (_index) {
+        auto it = _index->find(elem);
+        return it == _index->end() ? 0 : it->second;
+    }
     return ::count(_stack.begin(), _stack.end(), elem);
 }
 
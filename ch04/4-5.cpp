@@ -1,71 +1,85 @@
 #include <iostream>
+#include "../ch06/matrix/parallel.h"
+#include "../ch06/matrix/MatrixFile.h"
 using namespace std;
 
 // 一个n*n的矩阵（难点在于二维数组的分配）
+// 二维数组以行主序存放在一整块大小为_size * _size的连续内存中，只需一次new，
+// 乘法内核也能按行流式访问，而不是每一行都跳一次指针。
 class Matrix {
     friend Matrix operator+(const Matrix &, const Matrix &);
     friend Matrix operator*(const Matrix &, const Matrix &);
 
 public:
     Matrix(int n, const double *);
-    Matrix(int n):_size(n) {
-        _matrix = new double*[_max_size];
-        for (int i = 0; i < _max_size; i++) {
-            _matrix[i] = new double[_max_size];
-        }
-        for (int i = 0; i < _size; i++) {
-            for (int j = 0; j < _size; j++) {
-                _matrix[i][j] = 0;
-            }
-        }
-    }
+    // ()对数组做值初始化，即全部置0
+    Matrix(int n):_size(n), _matrix(new double[n * n]()) {}
     // copy constructor
-    Matrix(const Matrix &m):_size(m._size) {
-        _matrix = new double*[_max_size];
-        for (int i = 0; i < _max_size; i++) {
-            _matrix[i] = new double[_max_size];
-        }
-        for (int i = 0; i < _size; i++) {
-            for (int j = 0; j < _size; j++) {
-                _matrix[i][j] = m._matrix[i][j];
-            }
-        }
+    Matrix(const Matrix &m):_size(m._size), _matrix(new double[m._size * m._size]) {
+        for (int i = 0; i < _size * _size; i++) _matrix[i] = m._matrix[i];
+    }
+    // move constructor：接管m的数组，m变为0*0的空矩阵
+    Matrix(Matrix &&m) noexcept:_size(m._size), _matrix(m._matrix) {
+        m._size = 0;
+        m._matrix = nullptr;
     }
+    ~Matrix() { delete []_matrix; }
+    Matrix& operator=(const Matrix &);
+    Matrix& operator=(Matrix &&) noexcept;
+
     int rows() const { return _size; }
     int cols() const { return _size; }
 
     ostream& print(ostream&) const;
+    // 以二进制格式保存/读取（格式见ch06/matrix/MatrixFile.h），比print()快且不丢失精度
+    void save(const char *path) const;
+    static Matrix load(const char *path);
     void operator+=(const Matrix &);
     double operator()(int row, int column) const {
-        return _matrix[row][column];
+        return _matrix[row * _size + column];
     }
     double& operator()(int row, int column) {
-        return _matrix[row][column];
+        return _matrix[row * _size + column];
     }
 
 private:
-    const static int _max_size = 100;
     int _size;
-    double **_matrix;
+    double *_matrix;
 };
 
-Matrix::Matrix(int n, const double *arr):_size(n) {
-    _matrix = new double*[_max_size];
-    for (int i = 0; i < _max_size; i++) {
-        _matrix[i] = new double[_max_size];
+Matrix::Matrix(int n, const double *arr):_size(n), _matrix(new double[n * n]) {
+    for (int i = 0; i < _size * _size; i++) _matrix[i] = arr[i];
+}
+
+Matrix& Matrix::operator=(const Matrix &rhs) {
+    if (this != &rhs) {
+        // 大小相同时直接复用已有的数组
+        if (_size != rhs._size) {
+            delete []_matrix;
+            _size = rhs._size;
+            _matrix = new double[_size * _size];
+        }
+        for (int i = 0; i < _size * _size; i++) _matrix[i] = rhs._matrix[i];
     }
-    int idx = 0;
-    for (int i = 0; i < _size; i++) {
-        for (int j = 0; j < _size; j++)
-            _matrix[i][j] = arr[idx++];
+    return *this;
+}
+
+Matrix& Matrix::operator=(Matrix &&rhs) noexcept {
+    if (this != &rhs) {
+        delete []_matrix;
+        _size = rhs._size;
+        _matrix = rhs._matrix;
+        rhs._size = 0;
+        rhs._matrix = nullptr;
     }
+    return *this;
 }
 
 ostream& Matrix::print(ostream &os) const {
     int cnt = 1;
     for (int i = 0; i < _size; i++) {
         for (int j = 0; j < _size; j++) {
-            os << _matrix[i][j] << " ";
+            os << (*this)(i, j) << " ";
             if (cnt % 4 == 0) cout << endl;
             cnt++;
         }
@@ -74,12 +88,25 @@ ostream& Matrix::print(ostream &os) const {
     return os;
 }
 
-void Matrix::operator+=(const Matrix &rhs) {
-    for (int i = 0; i < _size; i++) {
-        for (int j = 0; j < _size; j++) {
-            _matrix[i][j] += rhs._matrix[i][j];
-        }
+void Matrix::save(const char *path) const {
+    matfile::MatrixFile<double> file(path, _size, _size);
+    file.write_block(0, 0, _size, _size, _matrix, _size);
+}
+
+Matrix Matrix::load(const char *path) {
+    matfile::MatrixFile<double> file(path);
+    if (file.rows() != file.cols()) {
+        cerr << "Matrix::load: not a square matrix" << endl;
+        exit(-1);
     }
+    Matrix m(int(file.rows()));
+    file.read_block(0, 0, m._size, m._size, m._matrix, m._size);
+    return m;
+}
+
+void Matrix::operator+=(const Matrix &rhs) {
+    // 逐行交给SIMD内核（规模够大时按行分块并行）
+    par_add(_size, _size, _matrix, _size, rhs._matrix, _size);
 }
 
 inline ostream& operator<<(ostream &os, const Matrix &m) {
@@ -94,14 +121,10 @@ Matrix operator+(const Matrix &m1, const Matrix &m2) {
 
 Matrix operator*(const Matrix &m1, const Matrix &m2) {
     Matrix res(m1._size);
-    for (int i = 0; i < m1.rows(); i++) {
-        for (int j = 0; j < m1.cols(); j++) {
-            res(i, j) = 0;
-            for (int k = 0; k < m1.cols(); k++) {
-                res(i, j) += m1(i, k) * m2(k, j);
-            }
-        }
-    }
+    // 行步长为_size，列步长为1
+    par_gemm(m1._size, m1._size, m1._size, 1.0,
+         m1._matrix, m1._size, 1, m2._matrix, m2._size, 1,
+         0.0, res._matrix, res._size, 1);
     return res;
 }
 
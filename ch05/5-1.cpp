@@ -1,6 +1,9 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <utility>
+#include <iterator>
+#include "stack/Segmented.h"
 using namespace std;
 
 typedef string elemType;
@@ -10,9 +13,14 @@ class Stack {
 public:
     virtual ~Stack() {}
 
+    // pop把栈顶元素移动到参数中；右值版本的push把参数移入栈中，都不复制字符串的内容
     virtual bool pop(elemType &) = 0;
     virtual bool push(const elemType &) = 0;
+    virtual bool push(elemType &&) = 0;
     virtual bool peek(int, elemType &) = 0;
+    // 模版不能是虚函数：先用参数构造一个elemType，再移入栈中
+    template <typename... Args>
+    bool emplace(Args&&... args) { return push(elemType(std::forward<Args>(args)...)); }
 
     virtual int top() const = 0;
     virtual int size() const = 0;
@@ -20,6 +28,32 @@ public:
     virtual bool empty() const = 0;
     virtual bool full() const = 0;
     virtual void print(ostream &os = cout) const = 0;
+
+    // 批量操作：每次虚调用传递一块（blocks::BLOCK个）元素，容量检查也是每块一次。都返回实际传递的个数
+    // 依次压入[first, last)，最后一个成为栈顶；传入make_move_iterator时元素被移入
+    template <typename InputIt>
+    int push_range(InputIt first, InputIt last) {
+        return blocks::push<elemType>(first, last, [this](elemType *buf, int k) { return push_block(buf, k); });
+    }
+    // 弹出最多n个元素，从栈顶开始依次移动到out，顺序与调用n次pop相同
+    template <typename OutputIt>
+    int pop_n(int n, OutputIt out) {
+        return blocks::pull<elemType>(n, out, [this](int, elemType *buf, int k) { return pop_block(buf, k); });
+    }
+    // 从下标index（与peek相同）开始的最多n个元素依次复制到out，不支持peek的栈返回0
+    template <typename OutputIt>
+    int peek_range(int index, int n, OutputIt out) {
+        return blocks::pull<elemType>(n, out, [this, index](int done, elemType *buf, int k) {
+            return peek_block(index + done, buf, k);
+        });
+    }
+
+protected:
+    // 批量操作的实现：push_block从first[0, n)中移入，pop_block把栈顶的最多n个元素移到out，
+    // peek_block把[index, index + n)中存在的元素复制到out
+    virtual int push_block(elemType *first, int n) = 0;
+    virtual int pop_block(elemType *out, int n) = 0;
+    virtual int peek_block(int index, elemType *out, int n) = 0;
 };
 
 ostream& operator<<(ostream &os, const Stack &rhs) {
@@ -35,6 +69,7 @@ public:
 
     bool pop(elemType &) override;
     bool push(const elemType &) override;
+    bool push(elemType &&) override;
     bool peek(int, elemType &) override { return false; }
 
     int top() const override { return _top; }
@@ -44,8 +79,14 @@ public:
 
     void print(ostream &os = cout) const override;
 
+protected:
+    int push_block(elemType *, int) override;
+    int pop_block(elemType *, int) override;
+    int peek_block(int, elemType *, int) override { return 0; }
+
 private:
-    vector<elemType> _stack;
+    // 分段存储（见stack/Segmented.h）：增长时不搬动已有的元素
+    SegmentedVector<elemType> _stack;
     int _top;
 };
 
@@ -57,6 +98,7 @@ public:
 
     bool pop(elemType &) override;
     bool push(const elemType &) override;
+    bool push(elemType &&) override;
     bool peek(int, elemType &) override;
 
     int top() const override { return _top; }
@@ -66,8 +108,14 @@ public:
 
     void print(ostream &os = cout) const;
 
+protected:
+    int push_block(elemType *, int) override;
+    int pop_block(elemType *, int) override;
+    int peek_block(int, elemType *, int) override;
+
 private:
-    vector<elemType> _stack;
+    // 分段存储（见stack/Segmented.h）：增长时不搬动已有的元素
+    SegmentedVector<elemType> _stack;
     int _top;
 };
 
@@ -75,7 +123,7 @@ private:
 // 程序代码文件
 bool FIFOStack::pop(elemType &elem) {
     if (empty()) return false;
-    elem = _stack[--_top];
+    elem = std::move(_stack[--_top]);
     _stack.pop_back();
     return true;
 }
@@ -87,6 +135,29 @@ bool FIFOStack::push(const elemType &elem) {
     return true;
 }
 
+bool FIFOStack::push(elemType &&elem) {
+    if (full()) return false;
+    _stack.push_back(std::move(elem));
+    _top++;
+    return true;
+}
+
+// 容量按块检查一次，整块移入、移出分段存储
+int FIFOStack::push_block(elemType *first, int n) {
+    size_t room = _stack.max_size() - _stack.size();
+    if (size_t(n) > room) n = int(room);
+    _stack.append(make_move_iterator(first), make_move_iterator(first + n));
+    _top += n;
+    return n;
+}
+
+int FIFOStack::pop_block(elemType *out, int n) {
+    if (n > _top) n = _top;
+    _stack.pop_back_n(n, out);
+    _top -= n;
+    return n;
+}
+
 void FIFOStack::print(ostream &os) const {
     auto r_it = _stack.rbegin(), r_end = _stack.rend();
     os << "\n\t";
@@ -98,7 +169,7 @@ void FIFOStack::print(ostream &os) const {
 
 bool PeekBackStack::pop(elemType &elem) {
     if (empty()) return false;
-    elem = _stack[--_top];
+    elem = std::move(_stack[--_top]);
     _stack.pop_back();
     return true;
 }
@@ -110,6 +181,13 @@ bool PeekBackStack::push(const elemType &elem) {
     return true;
 }
 
+bool PeekBackStack::push(elemType &&elem) {
+    if (full()) return false;
+    _stack.push_back(std::move(elem));
+    _top++;
+    return true;
+}
+
 bool PeekBackStack::peek(int index, elemType &elem) {
     if (empty()) return false;
     if (index < 0 || index >= size()) return false;
@@ -117,6 +195,29 @@ bool PeekBackStack::peek(int index, elemType &elem) {
     return true;
 }
 
+// 容量按块检查一次，整块移入、移出分段存储
+int PeekBackStack::push_block(elemType *first, int n) {
+    size_t room = _stack.max_size() - _stack.size();
+    if (size_t(n) > room) n = int(room);
+    _stack.append(make_move_iterator(first), make_move_iterator(first + n));
+    _top += n;
+    return n;
+}
+
+int PeekBackStack::pop_block(elemType *out, int n) {
+    if (n > _top) n = _top;
+    _stack.pop_back_n(n, out);
+    _top -= n;
+    return n;
+}
+
+int PeekBackStack::peek_block(int index, elemType *out, int n) {
+    if (index < 0 || index >= size()) return 0;
+    if (n > size() - index) n = size() - index;
+    _stack.copy_n(index, n, out);
+    return n;
+}
+
 void PeekBackStack::print(ostream &os) const {
     auto r_it = _stack.rbegin(), r_end = _stack.rend();
     os << "\n\t";
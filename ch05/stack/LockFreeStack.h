@@ -0,0 +1,163 @@
+#ifndef CODING_LOCKFREESTACK_H
+#define CODING_LOCKFREESTACK_H
+
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <cstdlib>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 多生产者、多消费者的无锁栈（Treiber栈），与ch04/4-2.cpp中Stack的push/pop/empty/size用法相同，但可以被多个线程同时使用。
+// 栈顶是一个64位的原子字：低32位是栈顶节点的编号（0表示空栈），高32位是一个标签，每次修改都加一。
+// push、pop都是"读栈顶、准备好新值、CAS"，失败就重来，任何时刻总有一个线程的CAS成功（lock-free）。
+//
+// ABA：线程A读到栈顶为X、下一个为Y，被挂起；其他线程弹出X、Y，又把X压回去。
+// 只比较指针的话，A的CAS会成功并把已经不在栈里的Y设为栈顶。带上标签之后，栈顶即使还是X，标签也已经变了，A的CAS必然失败。
+//
+// 内存回收：弹出的节点不会被释放，而是进入同样带标签的空闲链表，供之后的push复用；节点所在的slab只在栈析构时释放。
+// 所以一个落后的线程即使还拿着已经弹出（甚至已被复用）的节点，读它的next也总是读到合法的内存，
+// 读到的旧值只会让它的CAS失败。元素的值只由CAS成功、独占这个节点的线程读写，不会有数据竞争。
+template <typename T>
+class LockFreeStack {
+public:
+    LockFreeStack(): _head(0), _free(0), _size(0), _allocated(1) {
+        for (int i = 0; i < MAX_SLABS; i++) _slabs[i].store(nullptr, std::memory_order_relaxed);
+    }
+    LockFreeStack(const LockFreeStack &) = delete;
+    LockFreeStack& operator=(const LockFreeStack &) = delete;
+    // 析构时不能再有其他线程使用这个栈
+    ~LockFreeStack() {
+        for (uint32_t idx = index(_head.load(std::memory_order_acquire)); idx; idx = node(idx).next.load(std::memory_order_relaxed))
+            reinterpret_cast<T *>(node(idx).storage)->~T();
+        for (int i = 0; i < MAX_SLABS; i++) delete []_slabs[i].load(std::memory_order_relaxed);
+    }
+
+    // 节点编号用尽（约43亿个元素）时返回false
+    bool push(const T &elem) { return emplace(elem); }
+    bool push(T &&elem) { return emplace(std::move(elem)); }
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        uint32_t idx = allocate();
+        if (!idx) return false;
+        Node &n = node(idx);
+        new (n.storage) T(std::forward<Args>(args)...);
+        // 先计数再发布：弹出这个节点的pop经由_head的release/acquire看到这次加一，它的减一一定排在后面
+        _size.fetch_add(1, std::memory_order_relaxed);
+        link(_head, idx);
+        return true;
+    }
+    // 栈为空时返回false
+    bool pop(T &elem) {
+        uint32_t idx = unlink(_head);
+        if (!idx) return false;
+        _size.fetch_sub(1, std::memory_order_relaxed);
+        Node &n = node(idx);
+        T *val = reinterpret_cast<T *>(n.storage);
+        elem = std::move(*val);
+        val->~T();
+        link(_free, idx);
+        return true;
+    }
+
+    bool empty() const { return index(_head.load(std::memory_order_acquire)) == 0; }
+    bool full() const {
+        return index(_free.load(std::memory_order_acquire)) == 0 && _allocated.load(std::memory_order_relaxed) > MAX_NODES;
+    }
+    // 近似值：有其他线程正在push、pop时，可能把已计数但尚未压入的元素也算在内，但不会是负数
+    int size() const { return _size.load(std::memory_order_relaxed); }
+
+private:
+    struct Node {
+        std::atomic<uint32_t> next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // 第s个slab有FIRST_SLAB << s个节点，节点编号从1开始连续分配，所以slab只会追加、不会移动
+    static const uint32_t FIRST_SLAB = 64;
+    static const int MAX_SLABS = 26;
+    static const uint32_t MAX_NODES = FIRST_SLAB * ((1u << MAX_SLABS) - 1);
+
+    static uint32_t index(uint64_t word) { return uint32_t(word); }
+    static uint64_t pack(uint32_t idx, uint64_t old) { return ((old >> 32) + 1) << 32 | idx; }
+
+    Node& node(uint32_t idx) const {
+        uint64_t i = idx - 1;
+        int s = 63 - __builtin_clzll(i / FIRST_SLAB + 1);
+        Node *slab = _slabs[s].load(std::memory_order_acquire);
+        return slab[i - FIRST_SLAB * ((uint64_t(1) << s) - 1)];
+    }
+
+    // CAS失败说明有竞争，稍等再重试，减少对同一缓存行的争抢
+    struct Backoff {
+        int spins = 1;
+        void pause() {
+            for (int i = 0; i < spins; i++) {
+#if defined(__x86_64__) || defined(__i386__)
+                _mm_pause();
+#endif
+            }
+            if (spins < 1024) spins *= 2;
+        }
+    };
+
+    // 把节点idx压入以top为栈顶的链表（栈本身或空闲链表）
+    static void link(std::atomic<uint64_t> &top, uint32_t idx, Node &n) {
+        uint64_t old = top.load(std::memory_order_relaxed);
+        Backoff backoff;
+        for (;;) {
+            n.next.store(index(old), std::memory_order_relaxed);
+            if (top.compare_exchange_weak(old, pack(idx, old), std::memory_order_release, std::memory_order_relaxed)) return;
+            backoff.pause();
+        }
+    }
+    void link(std::atomic<uint64_t> &top, uint32_t idx) { link(top, idx, node(idx)); }
+
+    // 从以top为栈顶的链表中弹出一个节点，链表为空时返回0
+    uint32_t unlink(std::atomic<uint64_t> &top) {
+        uint64_t old = top.load(std::memory_order_acquire);
+        Backoff backoff;
+        for (;;) {
+            uint32_t idx = index(old);
+            if (!idx) return 0;
+            // 这个节点可能已经被别的线程弹出、复用，读到的next是旧的也没关系：那时标签已经变了，下面的CAS一定失败
+            uint32_t next = node(idx).next.load(std::memory_order_relaxed);
+            if (top.compare_exchange_weak(old, pack(next, old), std::memory_order_acquire, std::memory_order_acquire)) return idx;
+            backoff.pause();
+        }
+    }
+
+    // 优先复用空闲链表中的节点，否则取一个新编号，必要时追加一个slab
+    uint32_t allocate() {
+        if (uint32_t idx = unlink(_free)) return idx;
+        uint32_t idx = _allocated.fetch_add(1, std::memory_order_relaxed);
+        if (idx > MAX_NODES || idx == 0) {
+            _allocated.store(MAX_NODES + 1, std::memory_order_relaxed);
+            return 0;
+        }
+        uint64_t i = idx - 1;
+        int s = 63 - __builtin_clzll(i / FIRST_SLAB + 1);
+        if (!_slabs[s].load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(_grow);
+            if (!_slabs[s].load(std::memory_order_relaxed)) {
+                Node *slab = new Node[size_t(FIRST_SLAB) << s];
+                _slabs[s].store(slab, std::memory_order_release);
+            }
+        }
+        return idx;
+    }
+
+    // 栈顶和空闲链表各占一个缓存行，避免两者之间的伪共享
+    alignas(64) std::atomic<uint64_t> _head;
+    alignas(64) std::atomic<uint64_t> _free;
+    alignas(64) std::atomic<int> _size;
+    std::atomic<uint32_t> _allocated;
+    std::atomic<Node *> _slabs[MAX_SLABS];
+    std::mutex _grow;
+};
+
+#endif //CODING_LOCKFREESTACK_H
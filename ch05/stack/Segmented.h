@@ -0,0 +1,342 @@
+#ifndef CODING_SEGMENTED_H
+#define CODING_SEGMENTED_H
+
+#include <iterator>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+// 分段存储的顺序容器，用作栈的底层存储（ch04/4-2.cpp、ch05/5-1.cpp、Stack.h）。
+// vector在容量不够时要整体搬家：重新分配、把每个元素复制（或移动）过去；元素是string时代价很高，
+// 而且搬家期间新旧两份同时存在。这里把元素存放在定长的块（chunk）里，另用一张表记录各块的地址：
+// 增长时只追加一个块，表本身搬家也只是复制指针，已有的元素永远不会移动，它们的地址和引用一直有效。
+// 接口与栈用到的那部分vector相同：push_back/emplace_back/pop_back/back/operator[]/迭代器。
+//
+// 块的回收：元素弹空的块先留一个在手里（在块的边界附近反复push、pop时不必反复申请、释放），
+// 更多的交给同类型共享的ChunkPool，下次任何一个SegmentedVector<T>增长时优先从池中取。
+
+// 同一元素类型的所有SegmentedVector共享的空闲块链表。取、还都只在跨越块边界时发生，加锁的代价可以忽略
+template <typename T, size_t ChunkSize>
+class ChunkPool {
+public:
+    static ChunkPool& instance() {
+        // 有意不析构：静态或线程局部的栈在程序退出时析构，仍可能往池中归还块
+        static ChunkPool *pool = new ChunkPool;
+        return *pool;
+    }
+
+    T* get() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_free.empty()) {
+                T *chunk = _free.back();
+                _free.pop_back();
+                return chunk;
+            }
+        }
+        return static_cast<T *>(::operator new(ChunkSize * sizeof(T)));
+    }
+    // 池中最多缓存MAX_CACHED个块，多出来的直接释放
+    void put(T *chunk) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_free.size() < MAX_CACHED) {
+                _free.push_back(chunk);
+                return;
+            }
+        }
+        ::operator delete(chunk);
+    }
+
+private:
+    static const size_t MAX_CACHED = 64;
+
+    ChunkPool() { _free.reserve(MAX_CACHED); }
+
+    std::mutex _mutex;
+    std::vector<T *> _free;
+};
+
+// 每块大约4KB，块内元素个数取2的幂，下标换算成(块号, 块内位置)只需移位和按位与
+template <typename T>
+constexpr size_t chunk_size_of() {
+    size_t n = 16;
+    while (n * 2 * sizeof(T) <= 4096) n *= 2;
+    return n;
+}
+
+template <typename T>
+class SegmentedVector {
+public:
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned element types are not supported");
+    static const size_t CHUNK = chunk_size_of<T>();
+    typedef ChunkPool<T, CHUNK> Pool;
+
+    typedef T value_type;
+    class const_iterator;
+    typedef const_iterator iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+    typedef const_reverse_iterator reverse_iterator;
+
+    SegmentedVector(): _size(0), _keep(0) {}
+    ~SegmentedVector() {
+        clear();
+        release(0);
+    }
+    SegmentedVector(const SegmentedVector &rhs): _size(0), _keep(0) {
+        reserve(rhs._size);
+        for (const T &elem : rhs) push_back(elem);
+    }
+    SegmentedVector& operator=(const SegmentedVector &rhs) {
+        if (this != &rhs) {
+            SegmentedVector tmp(rhs);
+            swap(tmp);
+        }
+        return *this;
+    }
+    SegmentedVector(SegmentedVector &&rhs) noexcept: _chunks(std::move(rhs._chunks)), _size(rhs._size), _keep(rhs._keep) {
+        rhs._chunks.clear();
+        rhs._size = 0;
+        rhs._keep = 0;
+    }
+    SegmentedVector& operator=(SegmentedVector &&rhs) noexcept {
+        SegmentedVector tmp(std::move(rhs));
+        swap(tmp);
+        return *this;
+    }
+    void swap(SegmentedVector &rhs) noexcept {
+        _chunks.swap(rhs._chunks);
+        std::swap(_size, rhs._size);
+        std::swap(_keep, rhs._keep);
+    }
+
+    void push_back(const T &elem) { emplace_back(elem); }
+    void push_back(T &&elem) { emplace_back(std::move(elem)); }
+    // 在块中原地构造，返回新元素的引用
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (_size == _chunks.size() * CHUNK) _chunks.push_back(Pool::instance().get());
+        T *p = slot(_size);
+        new (p) T(std::forward<Args>(args)...);
+        _size++;
+        return *p;
+    }
+    void pop_back() {
+        slot(--_size)->~T();
+        // 刚弹空一个块：手里保留一个空块，再多的还给池（reserve过的不还）
+        if (_size % CHUNK == 0 && _chunks.size() > chunks_for(_size) + 1 && _chunks.size() > _keep)
+            release(_chunks.size() - 1);
+    }
+
+    // 批量操作：按块整段处理，每块内是连续内存，元素平凡可复制、迭代器是指针时std::uninitialized_copy、std::copy就是memmove。
+    // 在末尾追加[first, last)。前向迭代器先一次取够所需的块
+    template <typename InputIt>
+    void append(InputIt first, InputIt last) {
+        append(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+    }
+    // 弹出末尾的n个元素（n <= size()），从最后一个开始依次移动到out
+    template <typename OutputIt>
+    OutputIt pop_back_n(size_t n, OutputIt out) {
+        while (n) {
+            size_t off = (_size - 1) % CHUNK + 1, k = off < n ? off : n;
+            T *hi = slot(_size - 1) + 1, *lo = hi - k;
+            out = std::move(std::make_reverse_iterator(hi), std::make_reverse_iterator(lo), out);
+            std::destroy(lo, hi);
+            _size -= k;
+            n -= k;
+        }
+        // 与pop_back相同：多余的空块只留一个
+        size_t keep = chunks_for(_size) + 1;
+        if (keep < _keep) keep = _keep;
+        if (_chunks.size() > keep) release(keep);
+        return out;
+    }
+    // 把下标[i, i + n)的元素依次复制到out
+    template <typename OutputIt>
+    OutputIt copy_n(size_t i, size_t n, OutputIt out) const {
+        while (n) {
+            size_t off = i % CHUNK, k = CHUNK - off < n ? CHUNK - off : n;
+            const T *lo = slot(i);
+            out = std::copy(lo, lo + k, out);
+            i += k;
+            n -= k;
+        }
+        return out;
+    }
+
+    T& back() { return *slot(_size - 1); }
+    const T& back() const { return *slot(_size - 1); }
+    T& operator[](size_t i) { return *slot(i); }
+    const T& operator[](size_t i) const { return *slot(i); }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    size_t max_size() const { return size_t(-1) / sizeof(T); }
+    // 已经拿在手里的块能容纳的元素个数
+    size_t capacity() const { return _chunks.size() * CHUNK; }
+
+    // 预先取够容纳n个元素的块；这些块在pop_back时不会还给池
+    void reserve(size_t n) {
+        size_t need = chunks_for(n);
+        if (need > _keep) _keep = need;
+        _chunks.reserve(need);
+        while (_chunks.size() < need) _chunks.push_back(Pool::instance().get());
+    }
+    void clear() {
+        while (_size) slot(--_size)->~T();
+    }
+    // 把没有用到的块全部还给池
+    void shrink_to_fit() {
+        _keep = 0;
+        release(chunks_for(_size));
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _size); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    // 随机访问迭代器，记录容器和下标；push_back、pop_back不会使指向其他元素的迭代器失效
+    class const_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator(): _vec(nullptr), _i(0) {}
+        reference operator*() const { return (*_vec)[_i]; }
+        pointer operator->() const { return &(*_vec)[_i]; }
+        reference operator[](difference_type n) const { return (*_vec)[_i + n]; }
+
+        const_iterator& operator++() { ++_i; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++_i; return tmp; }
+        const_iterator& operator--() { --_i; return *this; }
+        const_iterator operator--(int) { const_iterator tmp = *this; --_i; return tmp; }
+        const_iterator& operator+=(difference_type n) { _i += n; return *this; }
+        const_iterator& operator-=(difference_type n) { _i -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(_vec, _i + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(_vec, _i - n); }
+        friend const_iterator operator+(difference_type n, const const_iterator &it) { return it + n; }
+        difference_type operator-(const const_iterator &rhs) const { return difference_type(_i) - difference_type(rhs._i); }
+
+        bool operator==(const const_iterator &rhs) const { return _i == rhs._i; }
+        bool operator!=(const const_iterator &rhs) const { return _i != rhs._i; }
+        bool operator<(const const_iterator &rhs) const { return _i < rhs._i; }
+        bool operator>(const const_iterator &rhs) const { return _i > rhs._i; }
+        bool operator<=(const const_iterator &rhs) const { return _i <= rhs._i; }
+        bool operator>=(const const_iterator &rhs) const { return _i >= rhs._i; }
+
+    private:
+        friend class SegmentedVector;
+        const_iterator(const SegmentedVector *vec, size_t i): _vec(vec), _i(i) {}
+
+        const SegmentedVector *_vec;
+        size_t _i;
+    };
+
+private:
+    template <typename InputIt>
+    void append(InputIt first, InputIt last, std::input_iterator_tag) {
+        for (; first != last; ++first) emplace_back(*first);
+    }
+    template <typename ForwardIt>
+    void append(ForwardIt first, ForwardIt last, std::forward_iterator_tag) {
+        size_t n = size_t(std::distance(first, last));
+        size_t need = chunks_for(_size + n);
+        _chunks.reserve(need);
+        while (_chunks.size() < need) _chunks.push_back(Pool::instance().get());
+        while (n) {
+            size_t off = _size % CHUNK, k = CHUNK - off < n ? CHUNK - off : n;
+            ForwardIt mid = std::next(first, k);
+            // 构造到一半抛出异常时，uninitialized_copy会析构这一段已经构造的，之前各段已经计入_size
+            std::uninitialized_copy(first, mid, slot(_size));
+            _size += k;
+            n -= k;
+            first = mid;
+        }
+    }
+
+    static size_t chunks_for(size_t n) { return (n + CHUNK - 1) / CHUNK; }
+    T* slot(size_t i) const { return _chunks[i / CHUNK] + i % CHUNK; }
+    // 把第from块及之后的块（此时都是空的）还给池
+    void release(size_t from) {
+        while (_chunks.size() > from) {
+            Pool::instance().put(_chunks.back());
+            _chunks.pop_back();
+        }
+    }
+
+    std::vector<T *> _chunks;
+    size_t _size;
+    size_t _keep;       // reserve()要求保留的块数
+};
+
+// 虚函数不能是模版，经由虚函数的栈（5-1.cpp的Stack、Stack.h的AnyStack）的批量操作只接受指针。
+// 下面两个函数把迭代器区间转换成指针。一般情况下切成定长的块，经过一个缓冲区转交，每块一次虚调用；只有两种情况直接传指针、一次调用：
+//   push：指向连续T（T*、vector<T>的迭代器）的move_iterator。put会把元素移走，这正是调用者要的；
+//         不带move_iterator的T*区间要保留原来的元素，所以同其他迭代器一样先复制到缓冲区
+//   pull：输出是T*或vector<T>的迭代器，get直接写进去
+namespace blocks {
+
+const int BLOCK = 256;
+
+template <typename T, typename It>
+constexpr bool is_contiguous() {
+    return std::is_same<It, T *>::value || std::is_same<It, typename std::vector<T>::iterator>::value;
+}
+// 指向连续的T的move_iterator
+template <typename T, typename It> struct moves_contiguous: std::false_type {};
+template <typename T, typename It>
+struct moves_contiguous<T, std::move_iterator<It> >: std::integral_constant<bool, is_contiguous<T, It>()> {};
+
+// 把[first, last)交给put(指针, 个数)，put可以把元素从指针处移走，返回实际接收的个数；接收不满时停止。
+// 返回接收的总数。只有move_iterator（元素本来就要被移走）可以不经过缓冲区
+template <typename T, typename InputIt, typename Put>
+int push(InputIt first, InputIt last, Put put) {
+    if constexpr (moves_contiguous<T, InputIt>::value) {
+        int n = int(last - first);
+        return n > 0 ? put(&*first.base(), n) : 0;
+    }
+    std::vector<T> buf(BLOCK);
+    int total = 0;
+    while (first != last) {
+        int k = 0;
+        for (; k < BLOCK && first != last; ++k, ++first) buf[k] = *first;
+        int done = put(buf.data(), k);
+        total += done;
+        if (done < k) break;
+    }
+    return total;
+}
+
+// 最多取n个元素：调用get(已经取出的个数, 指针, 个数)，get把元素移动或复制到指针处，返回实际填入的个数，不满时停止。
+// 取出的元素依次写到out，返回取出的总数
+template <typename T, typename OutputIt, typename Get>
+int pull(int n, OutputIt out, Get get) {
+    if (n <= 0) return 0;
+    if constexpr (is_contiguous<T, OutputIt>()) {
+        return get(0, &*out, n);
+    } else {
+        std::vector<T> buf(n < BLOCK ? n : BLOCK);
+        int total = 0;
+        while (total < n) {
+            int k = n - total < BLOCK ? n - total : BLOCK;
+            int got = get(total, buf.data(), k);
+            out = std::move(buf.begin(), buf.begin() + got, out);
+            total += got;
+            if (got < k) break;
+        }
+        return total;
+    }
+}
+
+}
+
+#endif //CODING_SEGMENTED_H
@@ -0,0 +1,222 @@
+#ifndef CODING_STACK_H
+#define CODING_STACK_H
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <iterator>
+#include "Segmented.h"
+
+// ch05/5-1.cpp中栈类体系的泛型、静态多态版本。
+// 5-1.cpp里每次push、pop、peek、size、empty都要经过虚函数表，编译器无法内联，元素类型也固定为string。
+// 这里用CRTP（奇异递归模版）：基类StackBase<Derived, T>实现共同的部分，需要派生类决定的行为
+// （peek）通过static_cast<Derived&>(*this)在编译期转发，所以没有虚函数，调用都可以内联。
+// 写成模版的代码（template <typename S> void f(StackBase<S, T> &s)）对每种栈各实例化一份。
+// 确实需要在运行时才决定栈的类型时，用类型擦除的AnyStack<T>（每次操作一次虚调用，与5-1.cpp相同）。
+// 放在命名空间stacks中，避免与5-1.cpp里同名的类冲突。
+namespace stacks {
+
+template <typename Derived, typename T>
+class StackBase {
+public:
+    typedef T value_type;
+
+    // 栈顶元素被移动到elem中
+    bool pop(T &elem) {
+        if (empty()) return false;
+        elem = std::move(_stack[--_top]);
+        _stack.pop_back();
+        return true;
+    }
+    bool push(const T &elem) { return emplace(elem); }
+    bool push(T &&elem) { return emplace(std::move(elem)); }
+    // 在栈顶原地构造
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        if (full()) return false;
+        _stack.emplace_back(std::forward<Args>(args)...);
+        _top++;
+        return true;
+    }
+    // 由派生类决定：FIFOStack不支持，PeekBackStack可以查看任意位置
+    bool peek(int index, T &elem) { return derived().peek_at(index, elem); }
+
+    // 批量操作，与5-1.cpp中的接口相同，都返回实际传递的个数。这里没有虚调用，不必经过缓冲区：
+    // 直接按块整段构造、移出、复制（见SegmentedVector的append、pop_back_n、copy_n）
+    // 依次压入[first, last)，最后一个成为栈顶；传入make_move_iterator时元素被移入
+    template <typename InputIt>
+    int push_range(InputIt first, InputIt last) {
+        size_t before = _stack.size();
+        _stack.append(first, last);
+        _top = int(_stack.size());
+        return int(_stack.size() - before);
+    }
+    // 弹出最多n个元素，从栈顶开始依次移动到out，顺序与调用n次pop相同
+    template <typename OutputIt>
+    int pop_n(int n, OutputIt out) {
+        if (n > _top) n = _top;
+        if (n <= 0) return 0;
+        _stack.pop_back_n(n, out);
+        _top -= n;
+        return n;
+    }
+    // 从下标index（与peek相同）开始的最多n个元素依次复制到out，不支持peek的栈返回0
+    template <typename OutputIt>
+    int peek_range(int index, int n, OutputIt out) { return derived().peek_range_at(index, n, out); }
+
+    int top() const { return _top; }
+    int size() const { return int(_stack.size()); }
+    bool empty() const { return !_top; }
+    bool full() const { return _stack.size() >= _stack.max_size(); }
+
+    // 从栈顶到栈底
+    void print(std::ostream &os = std::cout) const {
+        auto r_it = _stack.rbegin(), r_end = _stack.rend();
+        os << "\n\t";
+        while (r_it != r_end) {
+            os << *r_it++ << " ";
+        }
+        os << std::endl;
+    }
+
+protected:
+    explicit StackBase(int cap = 0): _top(0) {
+        if (cap) _stack.reserve(cap);
+    }
+    // 只能作为基类使用，不通过基类指针delete，所以析构函数不必是虚函数
+    ~StackBase() = default;
+
+    // 分段存储（见Segmented.h）：增长时不搬动已有的元素
+    SegmentedVector<T> _stack;
+    int _top;
+
+private:
+    Derived& derived() { return static_cast<Derived &>(*this); }
+};
+
+template <typename Derived, typename T>
+std::ostream& operator<<(std::ostream &os, const StackBase<Derived, T> &rhs) {
+    rhs.print(os);
+    return os;
+}
+
+template <typename T>
+class FIFOStack: public StackBase<FIFOStack<T>, T> {
+public:
+    explicit FIFOStack(int cap = 0): StackBase<FIFOStack<T>, T>(cap) {}
+
+private:
+    friend class StackBase<FIFOStack<T>, T>;
+    bool peek_at(int, T &) { return false; }
+    template <typename OutputIt> int peek_range_at(int, int, OutputIt) { return 0; }
+};
+
+template <typename T>
+class PeekBackStack: public StackBase<PeekBackStack<T>, T> {
+public:
+    explicit PeekBackStack(int cap = 0): StackBase<PeekBackStack<T>, T>(cap) {}
+
+private:
+    friend class StackBase<PeekBackStack<T>, T>;
+    bool peek_at(int index, T &elem) {
+        if (this->empty()) return false;
+        if (index < 0 || index >= this->size()) return false;
+        elem = this->_stack[index];
+        return true;
+    }
+    template <typename OutputIt>
+    int peek_range_at(int index, int n, OutputIt out) {
+        if (index < 0 || index >= this->size() || n <= 0) return 0;
+        if (n > this->size() - index) n = this->size() - index;
+        this->_stack.copy_n(index, n, out);
+        return n;
+    }
+};
+
+// 类型擦除的适配器：可以装下任何提供上述接口的栈（按值保存），对外是统一的类型。
+// 例如vector<AnyStack<string> >中既可以有FIFOStack，也可以有PeekBackStack
+template <typename T>
+class AnyStack {
+public:
+    typedef T value_type;
+
+    template <typename S, typename = typename std::enable_if<!std::is_same<S, AnyStack>::value>::type>
+    AnyStack(S stack): _impl(new Model<S>(std::move(stack))) {}
+
+    bool pop(T &elem) { return _impl->pop(elem); }
+    bool push(const T &elem) { return _impl->push(elem); }
+    bool push(T &&elem) { return _impl->push(std::move(elem)); }
+    // 与5-1.cpp相同：先构造再移入
+    template <typename... Args>
+    bool emplace(Args&&... args) { return push(T(std::forward<Args>(args)...)); }
+    bool peek(int index, T &elem) { return _impl->peek(index, elem); }
+    int top() const { return _impl->top(); }
+    int size() const { return _impl->size(); }
+    bool empty() const { return _impl->empty(); }
+    bool full() const { return _impl->full(); }
+    void print(std::ostream &os = std::cout) const { _impl->print(os); }
+
+    // 批量操作：与5-1.cpp相同，经由blocks::push/pull按块转交，每块一次虚调用（哪些区间不经过缓冲区见Segmented.h）
+    template <typename InputIt>
+    int push_range(InputIt first, InputIt last) {
+        return blocks::push<T>(first, last, [this](T *buf, int k) { return _impl->push_block(buf, k); });
+    }
+    template <typename OutputIt>
+    int pop_n(int n, OutputIt out) {
+        return blocks::pull<T>(n, out, [this](int, T *buf, int k) { return _impl->pop_block(buf, k); });
+    }
+    template <typename OutputIt>
+    int peek_range(int index, int n, OutputIt out) {
+        return blocks::pull<T>(n, out, [this, index](int done, T *buf, int k) { return _impl->peek_block(index + done, buf, k); });
+    }
+
+private:
+    struct Concept {
+        virtual ~Concept() {}
+        virtual bool pop(T &) = 0;
+        virtual bool push(const T &) = 0;
+        virtual bool push(T &&) = 0;
+        virtual bool peek(int, T &) = 0;
+        virtual int top() const = 0;
+        virtual int size() const = 0;
+        virtual bool empty() const = 0;
+        virtual bool full() const = 0;
+        virtual void print(std::ostream &) const = 0;
+        virtual int push_block(T *, int) = 0;
+        virtual int pop_block(T *, int) = 0;
+        virtual int peek_block(int, T *, int) = 0;
+    };
+    template <typename S>
+    struct Model: Concept {
+        explicit Model(S &&s): stack(std::move(s)) {}
+        bool pop(T &elem) override { return stack.pop(elem); }
+        bool push(const T &elem) override { return stack.push(elem); }
+        bool push(T &&elem) override { return stack.push(std::move(elem)); }
+        bool peek(int index, T &elem) override { return stack.peek(index, elem); }
+        int top() const override { return stack.top(); }
+        int size() const override { return stack.size(); }
+        bool empty() const override { return stack.empty(); }
+        bool full() const override { return stack.full(); }
+        void print(std::ostream &os) const override { stack.print(os); }
+        int push_block(T *first, int n) override {
+            return stack.push_range(std::make_move_iterator(first), std::make_move_iterator(first + n));
+        }
+        int pop_block(T *out, int n) override { return stack.pop_n(n, out); }
+        int peek_block(int index, T *out, int n) override { return stack.peek_range(index, n, out); }
+        S stack;
+    };
+
+    std::unique_ptr<Concept> _impl;
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream &os, const AnyStack<T> &rhs) {
+    rhs.print(os);
+    return os;
+}
+
+}
+
+#endif //CODING_STACK_H
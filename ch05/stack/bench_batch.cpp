@@ -0,0 +1,97 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <chrono>
+#include <cstdlib>
+#include "../5-1.cpp"
+#include "Stack.h"
+
+// 在两个栈之间按块搬运数据：逐个pop/push与pop_n/push_range对比。
+// 5-1.cpp的Stack经由虚函数表，批量操作每块一次虚调用；stacks::PeekBackStack<int>的批量操作按块整段memmove。
+// 用法：bench_batch [rounds=50] [n=100000] [block=4096]
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void report(const char *name, double t, long elems, long sum) {
+    cout << setw(32) << name << fixed << setprecision(2) << setw(8) << t * 1e9 / double(elems) << " ns/elem"
+         << "  (checksum " << sum << ")" << endl;
+}
+
+// 每轮把src中的全部元素经过buf搬到dst，再搬回来
+template <typename S, typename T>
+long by_element(S &src, S &dst, int rounds, int block) {
+    long sum = 0;
+    vector<T> buf(block);
+    for (int r = 0; r < rounds; r++) {
+        S *from = r % 2 ? &dst : &src, *to = r % 2 ? &src : &dst;
+        while (!from->empty()) {
+            int k = 0;
+            while (k < block && from->pop(buf[k])) k++;
+            for (int i = 0; i < k; i++) to->push(std::move(buf[i]));
+            sum += k;
+        }
+    }
+    return sum;
+}
+
+template <typename S, typename T>
+long by_block(S &src, S &dst, int rounds, int block) {
+    long sum = 0;
+    vector<T> buf(block);
+    for (int r = 0; r < rounds; r++) {
+        S *from = r % 2 ? &dst : &src, *to = r % 2 ? &src : &dst;
+        while (int k = from->pop_n(block, buf.begin())) {
+            to->push_range(make_move_iterator(buf.begin()), make_move_iterator(buf.begin() + k));
+            sum += k;
+        }
+    }
+    return sum;
+}
+
+template <typename S, typename T>
+void run(const char *name, S &src, S &dst, int rounds, int block, long elems, bool batched) {
+    long sum = 0;
+    double t = seconds([&] {
+        sum = batched ? by_block<S, T>(src, dst, rounds, block) : by_element<S, T>(src, dst, rounds, block);
+    });
+    report(name, t, elems, sum);
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 50;
+    int n = argc > 2 ? atoi(argv[2]) : 100000;
+    int block = argc > 3 ? atoi(argv[3]) : 4096;
+    long elems = long(rounds) * n;
+
+    cout << "string, virtual (5-1.cpp):" << endl;
+    for (int batched = 0; batched < 2; batched++) {
+        // 实际类型在运行时才确定，编译器无法去虚化
+        Stack *a = argc > 4 ? static_cast<Stack *>(new FIFOStack) : static_cast<Stack *>(new PeekBackStack);
+        Stack *b = argc > 4 ? static_cast<Stack *>(new FIFOStack) : static_cast<Stack *>(new PeekBackStack);
+        for (int i = 0; i < n; i++) a->push(to_string(i));
+        run<Stack, string>(batched ? "pop_n/push_range" : "pop/push", *a, *b, rounds, block, elems, batched);
+        delete a;
+        delete b;
+    }
+
+    cout << "int, CRTP:" << endl;
+    for (int batched = 0; batched < 2; batched++) {
+        stacks::PeekBackStack<int> a, b;
+        for (int i = 0; i < n; i++) a.push(i);
+        run<stacks::PeekBackStack<int>, int>(batched ? "pop_n/push_range" : "pop/push", a, b, rounds, block, elems, batched);
+    }
+
+    cout << "int, AnyStack:" << endl;
+    for (int batched = 0; batched < 2; batched++) {
+        stacks::AnyStack<int> a = stacks::PeekBackStack<int>(), b = stacks::PeekBackStack<int>();
+        for (int i = 0; i < n; i++) a.push(i);
+        run<stacks::AnyStack<int>, int>(batched ? "pop_n/push_range" : "pop/push", a, b, rounds, block, elems, batched);
+    }
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "LockFreeStack.h"
+using namespace std;
+
+// 共享工作栈的竞争测试：每个线程随机地push或pop（各一半），统计总吞吐量，
+// 对比LockFreeStack与用一个mutex保护的vector（即ch04/4-2.cpp的Stack在每次push/pop外加锁）。
+// 结束时检查没有元素丢失或重复：所有push进去的值之和 = 所有pop出来的值之和 + 栈中剩余的值之和。
+// 用法：bench_lockfree [seconds_per_case=0.5] [max_threads=64]
+
+template <typename T>
+class MutexStack {
+public:
+    bool push(const T &elem) {
+        lock_guard<mutex> lock(_mutex);
+        _stack.push_back(elem);
+        return true;
+    }
+    bool pop(T &elem) {
+        lock_guard<mutex> lock(_mutex);
+        if (_stack.empty()) return false;
+        elem = _stack.back();
+        _stack.pop_back();
+        return true;
+    }
+    bool empty() const {
+        lock_guard<mutex> lock(_mutex);
+        return _stack.empty();
+    }
+    int size() const {
+        lock_guard<mutex> lock(_mutex);
+        return int(_stack.size());
+    }
+
+private:
+    vector<T> _stack;
+    mutable mutex _mutex;
+};
+
+// 返回每秒完成的操作数；pushed、popped累计值的和，用于检查
+template <typename Stack>
+double run(Stack &stack, int threads, double secs, long &pushed, long &popped) {
+    atomic<bool> stop(false);
+    atomic<long> total(0), sum_in(0), sum_out(0);
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(t);
+            long ops = 0, in = 0, out = 0, x;
+            while (!stop.load(memory_order_relaxed)) {
+                if (gen() & 1) {
+                    x = long(gen() % 1000);
+                    stack.push(x);
+                    in += x;
+                } else if (stack.pop(x)) {
+                    out += x;
+                }
+                ops++;
+            }
+            total += ops;
+            sum_in += in;
+            sum_out += out;
+        });
+    }
+    this_thread::sleep_for(chrono::duration<double>(secs));
+    stop = true;
+    for (thread &th : pool) th.join();
+    pushed = sum_in;
+    popped = sum_out;
+    return total / secs;
+}
+
+template <typename Stack>
+bool check(Stack &stack, long pushed, long popped) {
+    long x, rest = 0;
+    while (stack.pop(x)) rest += x;
+    return pushed == popped + rest && stack.empty();
+}
+
+int main(int argc, char *argv[]) {
+    double secs = argc > 1 ? atof(argv[1]) : 0.5;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+    bool ok = true;
+    if (max_threads < 1) max_threads = 1;
+    // 2的幂个线程，最后总是测一次max_threads个（它不一定是2的幂）
+    vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+    cout << "threads       mutex+vector        lock-free" << endl;
+    for (int threads : thread_counts) {
+        long pushed, popped;
+        MutexStack<long> locked;
+        LockFreeStack<long> lockfree;
+        // 预先放一些元素，使pop大多能成功
+        for (long i = 0; i < 1000; i++) {
+            locked.push(0);
+            lockfree.push(0);
+        }
+        double a = run(locked, threads, secs, pushed, popped);
+        ok = check(locked, pushed, popped) && ok;
+        double b = run(lockfree, threads, secs, pushed, popped);
+        ok = check(lockfree, pushed, popped) && ok;
+        cout << setw(7) << threads << fixed << setprecision(2)
+             << setw(12) << a / 1e6 << " Mops/s" << setw(10) << b / 1e6 << " Mops/s"
+             << "  (x" << b / a << ")" << endl;
+    }
+    if (!ok) {
+        cerr << "lost or duplicated elements" << endl;
+        return 1;
+    }
+}
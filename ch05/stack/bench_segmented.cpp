@@ -0,0 +1,72 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "Stack.h"
+
+// 对比原来以vector为底层存储、push和pop都复制元素的栈，与分段存储（Segmented.h）、支持移动的stacks::FIFOStack。
+// 每轮压入n个长度为len的字符串（不预留容量），再全部弹出。
+// 用法：bench_segmented [rounds=20] [n=100000] [len=512]
+
+using namespace std;
+
+// 改动之前5-1.cpp中FIFOStack的做法
+class VectorStack {
+public:
+    bool push(const string &elem) {
+        _stack.push_back(elem);
+        return true;
+    }
+    bool pop(string &elem) {
+        if (_stack.empty()) return false;
+        elem = _stack.back();
+        _stack.pop_back();
+        return true;
+    }
+    bool empty() const { return _stack.empty(); }
+
+private:
+    vector<string> _stack;
+};
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename S, typename Push>
+void report(const char *name, int rounds, int n, const string &proto, Push push) {
+    long sum = 0;
+    double t = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            // 每轮新建一个栈，计入增长的代价
+            S s;
+            for (int i = 0; i < n; i++) {
+                string elem = proto;
+                elem[0] = char('a' + i % 26);
+                push(s, elem);
+            }
+            string out;
+            while (s.pop(out)) sum += out[0];
+        }
+    });
+    cout << setw(28) << name << fixed << setprecision(2) << setw(8) << t * 1e9 / (double(rounds) * n) << " ns/elem"
+         << "  (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    int n = argc > 2 ? atoi(argv[2]) : 100000;
+    int len = argc > 3 ? atoi(argv[3]) : 512;
+    string proto(len, 'x');
+
+    report<VectorStack>("vector, copy in/out", rounds, n, proto, [](VectorStack &s, string &e) { s.push(e); });
+    report<stacks::FIFOStack<string> >("segmented, copy in/move out", rounds, n, proto,
+                                       [](stacks::FIFOStack<string> &s, string &e) { s.push(e); });
+    report<stacks::FIFOStack<string> >("segmented, move in/out", rounds, n, proto,
+                                       [](stacks::FIFOStack<string> &s, string &e) { s.push(std::move(e)); });
+}
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "../5-1.cpp"
+#include "Stack.h"
+
+// 对比5-1.cpp中经由虚函数表的Stack、静态多态的stacks::PeekBackStack<T>与类型擦除的stacks::AnyStack<T>：
+// 同样的循环（push、peek、size、empty、pop）各做若干轮。元素类型为string（5-1.cpp只支持string）时
+// 复制字符串本身占了不少时间，所以另外给出int的结果，更能看出调用开销的差别。
+// 用法：bench_virtual [rounds=200] [n=100000]
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// 对任何提供push/peek/pop等接口的栈都适用；S是具体类型时所有调用都可以内联
+template <typename S, typename T>
+long work(S &s, const T &x, int rounds, int n) {
+    long sum = 0;
+    T y;
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) s.push(x);
+        for (int i = 0; i < n; i += 64) sum += s.peek(i, y);
+        while (!s.empty()) {
+            sum += s.size();
+            s.pop(y);
+        }
+    }
+    return sum;
+}
+
+template <typename T, typename S>
+void report(const char *name, S &s, const T &x, int rounds, int n) {
+    long sum = 0;
+    double t = seconds([&] { sum = work(s, x, rounds, n); });
+    cout << setw(24) << name << fixed << setprecision(2) << setw(8) << t * 1e9 / (double(rounds) * n) << " ns/elem"
+         << "  (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    int n = argc > 2 ? atoi(argv[2]) : 100000;
+
+    string str = "short";
+    // 实际类型在运行时才确定，编译器无法去虚化
+    Stack *legacy = argc > 3 ? static_cast<Stack *>(new FIFOStack) : static_cast<Stack *>(new PeekBackStack);
+    stacks::PeekBackStack<string> s1;
+    stacks::AnyStack<string> a1 = stacks::PeekBackStack<string>();
+    cout << "string:" << endl;
+    report("virtual (5-1.cpp)", *legacy, str, rounds, n);
+    report("CRTP", s1, str, rounds, n);
+    report("AnyStack", a1, str, rounds, n);
+    delete legacy;
+
+    stacks::PeekBackStack<int> s2;
+    stacks::AnyStack<int> a2 = stacks::PeekBackStack<int>();
+    cout << "int:" << endl;
+    report("CRTP", s2, 7, rounds, n);
+    report("AnyStack", a2, 7, rounds, n);
+}
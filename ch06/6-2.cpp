@@ -1,30 +1,144 @@
 #include <iostream>
 #include <vector>
+#include <cstdlib>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/mman.h>
+#include "matrix/parallel.h"
+#include "matrix/transpose.h"
+#include "matrix/MatrixFile.h"
 using namespace std;
 
-template <typename elemType> class Matrix {
-    friend Matrix<elemType> operator+(const Matrix<elemType>&, const Matrix<elemType>&);
-    friend Matrix<elemType> operator*(const Matrix<elemType>&, const Matrix<elemType>&);
+// 表达式模版：operator+和operator*不再立即计算，而是返回一个记录了运算结构的轻量对象，
+// 直到赋值给Matrix时才一次性求值。逐元素的部分（+、数乘）在同一趟循环里融合计算，不产生临时矩阵；
+// 表达式中的矩阵乘积则直接交给分块乘法内核，结果累加进目标矩阵。
+// 注意：auto e = a + b; 得到的是表达式而非矩阵，它引用着a和b。
 
+// 所有矩阵表达式的基类（CRTP），派生类需要提供：
+//   value_type、elementwise（能否逐元素求值）、rows()、cols()、at(i, j)（仅elementwise）、
+//   overlaps(v)（是否读取视图v所在的内存）、unsafe_alias(v)（直接写入v是否会破坏尚未读取的数据）
+template <typename E> struct MatExpr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// 两段地址区间[lo1, hi1)与[lo2, hi2)是否相交
+inline bool ranges_overlap(const void *lo1, const void *hi1, const void *lo2, const void *hi2) {
+    uintptr_t a = uintptr_t(lo1), b = uintptr_t(hi1), c = uintptr_t(lo2), d = uintptr_t(hi2);
+    return a < d && c < b;
+}
+
+// ===== 视图 =====
+// 不拥有内存的矩阵视图：只记录首元素地址、形状和(行步长, 列步长)，
+// 因此子矩阵、某一行、某一列以及转置都能以O(1)的代价得到，而不拷贝任何元素。
+// T为const elemType时是只读视图。视图可以出现在任何表达式中，也可以作为赋值的目标。
+template <typename T>
+class MatrixView: public MatExpr<MatrixView<T> > {
+public:
+    typedef typename remove_const<T>::type value_type;
+    static const bool elementwise = true;
+
+    MatrixView(T *data, int rows, int cols, long row_stride, long col_stride):
+    _data(data), _rows(rows), _cols(cols), _rs(row_stride), _cs(col_stride) {}
+    MatrixView(const MatrixView &) = default;
+    // 可写视图可以转换成只读视图
+    operator MatrixView<const value_type>() const {
+        return MatrixView<const value_type>(_data, _rows, _cols, _rs, _cs);
+    }
+
+    int rows() const { return _rows; }
+    int cols() const { return _cols; }
+    long row_stride() const { return _rs; }
+    long col_stride() const { return _cs; }
+    T* data() const { return _data; }
+    T& operator()(int row, int col) const { return _data[row * _rs + col * _cs]; }
+    const value_type& at(int row, int col) const { return _data[row * _rs + col * _cs]; }
+
+    MatrixView block(int row, int col, int rows, int cols) const {
+        if (row < 0 || col < 0 || row + rows > _rows || col + cols > _cols) {
+            cerr << "MatrixView::block: out of range" << endl;
+            exit(-1);
+        }
+        return MatrixView(_data + row * _rs + col * _cs, rows, cols, _rs, _cs);
+    }
+    MatrixView row(int i) const { return block(i, 0, 1, _cols); }
+    MatrixView col(int j) const { return block(0, j, _rows, 1); }
+    MatrixView transpose() const { return MatrixView(_data, _cols, _rows, _cs, _rs); }
+
+    // 视图覆盖的地址区间（步长均为非负）
+    const void* lo() const { return _data; }
+    const void* hi() const {
+        return _rows && _cols ? _data + (_rows - 1) * _rs + (_cols - 1) * _cs + 1 : _data;
+    }
+    template <typename V> bool overlaps(const V &v) const {
+        return ranges_overlap(lo(), hi(), v.lo(), v.hi());
+    }
+    // 与目标布局完全相同时，逐元素求值只会读取即将被覆盖的同一个元素，是安全的
+    template <typename V> bool unsafe_alias(const V &v) const {
+        return overlaps(v) && !(lo() == v.lo() && _rs == v.row_stride() && _cs == v.col_stride());
+    }
+
+    // 对视图赋值会写入它所引用的元素
+    MatrixView& operator=(const MatrixView &rhs) { return assign(rhs); }
+    template <typename E> MatrixView& operator=(const MatExpr<E> &expr) { return assign(expr.self()); }
+    template <typename E> void operator+=(const MatExpr<E> &);
+    ostream& print(ostream &) const;
+
+private:
+    template <typename E> MatrixView& assign(const E &);
+
+    T *_data;
+    int _rows;
+    int _cols;
+    long _rs;
+    long _cs;
+};
+
+template <typename T>
+inline ostream& operator<<(ostream &os, const MatrixView<T> &v) {
+    return v.print(os);
+}
+
+// 维度参数为Dynamic时是堆上分配、运行时确定大小的矩阵（下面这个偏特化）；
+// 否则是维度在编译期确定、元素直接存放在对象内部的定长矩阵（见文件末尾）。
+const int Dynamic = -1;
+template <typename elemType, int Rows = Dynamic, int Cols = Dynamic> class Matrix;
+
+template <typename elemType> class Matrix<elemType, Dynamic, Dynamic>: public MatExpr<Matrix<elemType> > {
 public:
+    typedef elemType value_type;
+    static const bool elementwise = true;
+
     Matrix(int rows, int cols): _rows(rows), _cols(cols) {
-        int size = _rows * _cols;
-        _matrix = new elemType[size];
-        // 如果elemType不是一个内置的数据类型，new elemType()可能会出错
-        for (int i = 0; i < size; i++) _matrix[i] = new elemType();
+        // 值初始化：内置类型为0，类类型调用default constructor
+        _matrix = new elemType[_rows * _cols]();
     }
     Matrix(const Matrix&);
+    // move constructor：接管rhs的数组，rhs变为0*0的空矩阵
+    Matrix(Matrix &&rhs) noexcept: _rows(rhs._rows), _cols(rhs._cols), _matrix(rhs._matrix) {
+        rhs._rows = rhs._cols = 0;
+        rhs._matrix = nullptr;
+    }
+    // 由表达式构造：直接在新分配的空间中求值
+    template <typename E> Matrix(const MatExpr<E>&);
     ~Matrix() { delete []_matrix; }
     Matrix& operator=(const Matrix&);
+    Matrix& operator=(Matrix &&) noexcept;
+    template <typename E> Matrix& operator=(const MatExpr<E>&);
     void operator+=(const Matrix&);
+    template <typename E> void operator+=(const MatExpr<E>&);
     elemType& operator()(int row, int col) {
         return _matrix[row * _cols + col];
     }
     const elemType& operator()(int row, int col) const {
         return _matrix[row * _cols + col];
     }
-    int rows() { return _rows; }
-    int cols() { return _cols; }
+    int rows() const { return _rows; }
+    int cols() const { return _cols; }
     bool same_size(const Matrix &m) const {
         return rows() == m._rows && cols() == m._cols;
     }
@@ -33,39 +147,273 @@ public:
     }
     ostream& print(ostream &) const;
 
+    // 按行主序直接访问底层数组
+    elemType* data() { return _matrix; }
+    const elemType* data() const { return _matrix; }
+    long row_stride() const { return _cols; }
+    long col_stride() const { return 1; }
+    const elemType& at(int row, int col) const { return _matrix[row * _cols + col]; }
+
+    // 视图：const矩阵得到只读视图
+    MatrixView<elemType> view() { return MatrixView<elemType>(_matrix, _rows, _cols, _cols, 1); }
+    MatrixView<const elemType> view() const { return MatrixView<const elemType>(_matrix, _rows, _cols, _cols, 1); }
+    MatrixView<elemType> block(int row, int col, int rows, int cols) { return view().block(row, col, rows, cols); }
+    MatrixView<const elemType> block(int row, int col, int rows, int cols) const { return view().block(row, col, rows, cols); }
+    MatrixView<elemType> row(int i) { return view().row(i); }
+    MatrixView<const elemType> row(int i) const { return view().row(i); }
+    MatrixView<elemType> col(int j) { return view().col(j); }
+    MatrixView<const elemType> col(int j) const { return view().col(j); }
+    MatrixView<elemType> transpose() { return view().transpose(); }
+    MatrixView<const elemType> transpose() const { return view().transpose(); }
+
+    const void* lo() const { return _matrix; }
+    const void* hi() const { return _matrix + _rows * _cols; }
+    template <typename V> bool overlaps(const V &v) const { return view().overlaps(v); }
+    template <typename V> bool unsafe_alias(const V &v) const { return view().unsafe_alias(v); }
+
 protected:
     int _rows;
     int _cols;
     elemType *_matrix;
+
+    // 把buffer（rows*cols）接管为自己的存储
+    void adopt(int rows, int cols, elemType *buffer) {
+        delete []_matrix;
+        _rows = rows;
+        _cols = cols;
+        _matrix = buffer;
+    }
 };
 
-template <typename elemType>
-inline ostream& operator<<(ostream &os, const Matrix<elemType> &m) {
+template <typename elemType, int Rows, int Cols>
+inline ostream& operator<<(ostream &os, const Matrix<elemType, Rows, Cols> &m) {
     return m.print(os);
 }
 
-template <typename elemType>
-Matrix<elemType> operator+(const Matrix<elemType> &m1, const Matrix<elemType> &m2) {
-    Matrix<elemType> res(m1);
-    res += m2;
-    return res;
-}
+// 表达式节点以值的方式保存子表达式（它们是临时对象）和视图，以引用的方式保存Matrix
+template <typename E> struct ExprRef { typedef const E type; };
+template <typename T> struct ExprRef<Matrix<T> > { typedef const Matrix<T>& type; };
 
-template <typename elemType>
-Matrix<elemType> operator*(const Matrix<elemType> &m1, const Matrix<elemType> &m2) {
-    if (!m1.comfortable(m2)) {
-        // exit
+// 矩阵乘积的操作数必须带有步长信息：Matrix直接引用，视图直接复制，其它表达式先求值成一个Matrix
+template <typename E> struct Operand { typedef const Matrix<typename E::value_type> type; };
+template <typename T> struct Operand<Matrix<T> > { typedef const Matrix<T>& type; };
+template <typename T> struct Operand<MatrixView<T> > { typedef const MatrixView<T> type; };
+
+// l + r
+template <typename L, typename R>
+class SumExpr: public MatExpr<SumExpr<L, R> > {
+public:
+    typedef typename L::value_type value_type;
+    static const bool elementwise = L::elementwise && R::elementwise;
+
+    SumExpr(const L &l, const R &r): _l(l), _r(r) {
+        if (l.rows() != r.rows() || l.cols() != r.cols()) {
+            cerr << "Matrix size mismatch in operator+" << endl;
+            exit(-1);
+        }
+    }
+    int rows() const { return _l.rows(); }
+    int cols() const { return _l.cols(); }
+    value_type at(int i, int j) const { return _l.at(i, j) + _r.at(i, j); }
+    template <typename V> bool overlaps(const V &v) const { return _l.overlaps(v) || _r.overlaps(v); }
+    template <typename V> bool unsafe_alias(const V &v) const { return _l.unsafe_alias(v) || _r.unsafe_alias(v); }
+    const L& lhs() const { return _l; }
+    const R& rhs() const { return _r; }
+
+private:
+    typename ExprRef<L>::type _l;
+    typename ExprRef<R>::type _r;
+};
+
+// s * e
+template <typename E>
+class ScaleExpr: public MatExpr<ScaleExpr<E> > {
+public:
+    typedef typename E::value_type value_type;
+    static const bool elementwise = E::elementwise;
+
+    ScaleExpr(const E &e, const value_type &s): _e(e), _s(s) {}
+    int rows() const { return _e.rows(); }
+    int cols() const { return _e.cols(); }
+    value_type at(int i, int j) const { return _s * _e.at(i, j); }
+    template <typename V> bool overlaps(const V &v) const { return _e.overlaps(v); }
+    template <typename V> bool unsafe_alias(const V &v) const { return _e.unsafe_alias(v); }
+    const E& expr() const { return _e; }
+    const value_type& scale() const { return _s; }
+
+private:
+    typename ExprRef<E>::type _e;
+    value_type _s;
+};
+
+// l * r（矩阵乘积，不能逐元素求值）
+template <typename L, typename R>
+class ProdExpr: public MatExpr<ProdExpr<L, R> > {
+public:
+    typedef typename L::value_type value_type;
+    static const bool elementwise = false;
+
+    ProdExpr(const L &l, const R &r): _l(l), _r(r) {
+        if (l.cols() != r.rows()) {
+            cerr << "Matrix size mismatch in operator*" << endl;
+            exit(-1);
+        }
     }
-    Matrix<elemType> res(m1.rows(), m2.cols());
-    for (int i = 0; i < m1.row(); i++) {
-        for (int j = 0; j < m1.cols(); j++) {
-            res(i, j) = 0;
-            for (int k = 0; k < m1.cols(); k++) {
-                res(i, j) += m1(i, k) * m2(k, j);
+    int rows() const { return _l.rows(); }
+    int cols() const { return _r.cols(); }
+    template <typename V> bool overlaps(const V &v) const { return _l.overlaps(v) || _r.overlaps(v); }
+    // 乘积的每个结果元素都要读取一整行和一整列，只要有重叠就不能直接写入
+    template <typename V> bool unsafe_alias(const V &v) const { return overlaps(v); }
+    const L& lhs() const { return _l; }
+    const R& rhs() const { return _r; }
+
+private:
+    typename ExprRef<L>::type _l;
+    typename ExprRef<R>::type _r;
+};
+
+template <typename L, typename R>
+inline SumExpr<L, R> operator+(const MatExpr<L> &l, const MatExpr<R> &r) {
+    return SumExpr<L, R>(l.self(), r.self());
+}
+
+template <typename L, typename R>
+inline ProdExpr<L, R> operator*(const MatExpr<L> &l, const MatExpr<R> &r) {
+    return ProdExpr<L, R>(l.self(), r.self());
+}
+
+template <typename E>
+inline ScaleExpr<E> operator*(const MatExpr<E> &e, const typename E::value_type &s) {
+    return ScaleExpr<E>(e.self(), s);
+}
+
+template <typename E>
+inline ScaleExpr<E> operator*(const typename E::value_type &s, const MatExpr<E> &e) {
+    return ScaleExpr<E>(e.self(), s);
+}
+
+// ===== 求值 =====
+// dst = s * e（acc为false）或dst += s * e（acc为true），dst是与e同样大小的视图，调用者保证不存在不安全的重叠
+
+// 逐元素表达式：一趟融合循环，规模大时按行分段交给线程池
+template <typename T, typename E>
+void eval_elementwise(const MatrixView<T> &dst, const E &e, const T &s, bool acc) {
+    int cols = e.cols();
+    par_range(e.rows(), [&](long begin, long end) {
+        for (int i = int(begin); i < int(end); i++) {
+            T *d = dst.data() + i * dst.row_stride();
+            long cs = dst.col_stride();
+            if (s == T(1)) {
+                if (acc) for (int j = 0; j < cols; j++) d[j * cs] += e.at(i, j);
+                else for (int j = 0; j < cols; j++) d[j * cs] = e.at(i, j);
+            } else {
+                if (acc) for (int j = 0; j < cols; j++) d[j * cs] += s * e.at(i, j);
+                else for (int j = 0; j < cols; j++) d[j * cs] = s * e.at(i, j);
             }
         }
+    }, max(1L, (1L << 16) / max(1, cols)));
+}
+
+template <typename T, typename E>
+void eval_expr(const MatrixView<T> &dst, const E &e, const T &s, bool acc) {
+    eval_elementwise(dst, e, s, acc);
+}
+
+// 单个矩阵或视图：累加交给SIMD加法内核，拷贝交给缓存无关的跨步拷贝（物化转置视图时尤其重要）
+template <typename T, typename U>
+void eval_leaf(const MatrixView<T> &dst, const MatrixView<U> &src, const T &s, bool acc) {
+    if (acc && s == T(1) && dst.col_stride() == 1 && src.col_stride() == 1) {
+        par_add(src.rows(), src.cols(), dst.data(), dst.row_stride(), src.data(), src.row_stride());
+    } else if (!acc && s == T(1)) {
+        long grain = max(1L, (1L << 16) / max(1, src.cols()));
+        par_range(src.rows(), [&](long begin, long end) {
+            copy_strided(int(end - begin), src.cols(),
+                         src.data() + begin * src.row_stride(), src.row_stride(), src.col_stride(),
+                         dst.data() + begin * dst.row_stride(), dst.row_stride(), dst.col_stride());
+        }, grain);
+    } else {
+        eval_elementwise(dst, src, s, acc);
     }
-    return res;
+}
+
+template <typename T>
+void eval_expr(const MatrixView<T> &dst, const Matrix<T> &m, const T &s, bool acc) {
+    eval_leaf(dst, m.view(), s, acc);
+}
+
+template <typename T, typename U>
+void eval_expr(const MatrixView<T> &dst, const MatrixView<U> &v, const T &s, bool acc) {
+    eval_leaf(dst, v, s, acc);
+}
+
+// 含有乘积的和：先求左边，再把右边累加上去
+template <typename T, typename L, typename R>
+void eval_expr(const MatrixView<T> &dst, const SumExpr<L, R> &e, const T &s, bool acc) {
+    if constexpr (SumExpr<L, R>::elementwise) {
+        eval_elementwise(dst, e, s, acc);
+    } else {
+        eval_expr(dst, e.lhs(), s, acc);
+        eval_expr(dst, e.rhs(), s, true);
+    }
+}
+
+// 含有乘积的数乘：把系数传下去，最终成为gemm的alpha
+template <typename T, typename E>
+void eval_expr(const MatrixView<T> &dst, const ScaleExpr<E> &e, const T &s, bool acc) {
+    if constexpr (ScaleExpr<E>::elementwise) eval_elementwise(dst, e, s, acc);
+    else eval_expr(dst, e.expr(), T(s * e.scale()), acc);
+}
+
+// 乘积：dst = s * l * r + (acc ? dst : 0)，交给分块乘法内核（转置等视图直接以步长传入，不做拷贝）
+template <typename T, typename L, typename R>
+void eval_expr(const MatrixView<T> &dst, const ProdExpr<L, R> &e, const T &s, bool acc) {
+    typename Operand<L>::type a(e.lhs());
+    typename Operand<R>::type b(e.rhs());
+    par_gemm(a.rows(), b.cols(), a.cols(), s,
+             a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(),
+             acc ? T(1) : T(), dst.data(), dst.row_stride(), dst.col_stride());
+}
+
+template <typename T>
+template <typename E>
+MatrixView<T>& MatrixView<T>::assign(const E &e) {
+    if (e.rows() != _rows || e.cols() != _cols) {
+        cerr << "Matrix size mismatch in MatrixView::operator=" << endl;
+        exit(-1);
+    }
+    if (e.unsafe_alias(*this)) {
+        Matrix<value_type> tmp(e);
+        eval_expr(*this, tmp, value_type(1), false);
+    } else {
+        eval_expr(*this, e, value_type(1), false);
+    }
+    return *this;
+}
+
+template <typename T>
+template <typename E>
+void MatrixView<T>::operator+=(const MatExpr<E> &expr) {
+    const E &e = expr.self();
+    if (e.rows() != _rows || e.cols() != _cols) {
+        cerr << "Matrix size mismatch in MatrixView::operator+=" << endl;
+        exit(-1);
+    }
+    if (e.unsafe_alias(*this)) {
+        Matrix<value_type> tmp(e);
+        eval_expr(*this, tmp, value_type(1), true);
+    } else {
+        eval_expr(*this, e, value_type(1), true);
+    }
+}
+
+template <typename T>
+ostream& MatrixView<T>::print(ostream &os) const {
+    for (int i = 0; i < _rows; i++) {
+        os << endl;
+        for (int j = 0; j < _cols; j++) os << at(i, j) << " ";
+    }
+    os << endl;
+    return os;
 }
 
 template <typename elemType>
@@ -76,25 +424,63 @@ _rows(rhs._rows), _cols(rhs._cols) {
     for (int i = 0; i < size; i++) _matrix[i] = rhs._matrix[i];
 }
 
+template <typename elemType>
+template <typename E>
+Matrix<elemType>::Matrix(const MatExpr<E> &expr):
+_rows(expr.self().rows()), _cols(expr.self().cols()) {
+    _matrix = new elemType[_rows * _cols];
+    eval_expr(view(), expr.self(), elemType(1), false);
+}
+
 template <typename elemType>
 Matrix<elemType>& Matrix<elemType>::operator=(const Matrix<elemType> &rhs) {
     if (this != &rhs) {
+        int size = rhs._rows * rhs._cols;
+        // 元素个数相同时直接复用已有的数组
+        if (size != _rows * _cols) adopt(rhs._rows, rhs._cols, new elemType[size]);
         _rows = rhs._rows;
         _cols = rhs._cols;
-        int size = _rows * _cols;
-        delete []_matrix;
-        _matrix = new elemType[size];
         for (int i = 0; i < size; i++) _matrix[i] = rhs._matrix[i];
     }
     return *this;
 }
 
 template <typename elemType>
-void Matrix<elemType>::operator+=(const Matrix<elemType> &rhs) {
-    int size = cols() * rows();
-    for (int i = 0; i < size; i++) {
-        *(_matrix + i) += *(rhs._matrix + i);
+Matrix<elemType>& Matrix<elemType>::operator=(Matrix<elemType> &&rhs) noexcept {
+    if (this != &rhs) {
+        adopt(rhs._rows, rhs._cols, rhs._matrix);
+        rhs._rows = rhs._cols = 0;
+        rhs._matrix = nullptr;
     }
+    return *this;
+}
+
+template <typename elemType>
+template <typename E>
+Matrix<elemType>& Matrix<elemType>::operator=(const MatExpr<E> &expr) {
+    const E &e = expr.self();
+    if (e.rows() != _rows || e.cols() != _cols || e.unsafe_alias(view())) {
+        // 形状改变，或者会在写入的同时读取自己（如a = a * b、a = a.transpose()），
+        // 先求值到新的空间，再释放旧的数组
+        elemType *buffer = new elemType[e.rows() * e.cols()];
+        eval_expr(MatrixView<elemType>(buffer, e.rows(), e.cols(), e.cols(), 1), e, elemType(1), false);
+        adopt(e.rows(), e.cols(), buffer);
+    } else {
+        eval_expr(view(), e, elemType(1), false);
+    }
+    return *this;
+}
+
+template <typename elemType>
+void Matrix<elemType>::operator+=(const Matrix<elemType> &rhs) {
+    // 按行分块交给线程池，每块内float/double/int会分派到本机最宽的SIMD内核
+    par_add(rows(), cols(), _matrix, cols(), rhs._matrix, rhs.cols());
+}
+
+template <typename elemType>
+template <typename E>
+void Matrix<elemType>::operator+=(const MatExpr<E> &expr) {
+    view() += expr;
 }
 
 template <typename elemType>
@@ -108,3 +494,638 @@ ostream& Matrix<elemType>::print(ostream &os) const {
     return os;
 }
 
+// ===== 定长矩阵 =====
+// 适用于3*3、4*4、6*6这类小矩阵：元素存放在对象内部，不需要new[]，也没有间接访问；
+// 加法与乘法都是constexpr，并通过参数包展开完全展开成直线代码。
+// 维度不匹配的+和*在编译期就会报错。接口与动态的Matrix<elemType>一致，
+// 因此把Matrix<double>换成Matrix<double, 4, 4>即可切换（构造函数的rows、cols参数仍然接受，只做断言）。
+template <typename elemType, int Rows, int Cols>
+class Matrix {
+    static_assert(Rows > 0 && Cols > 0, "fixed-size Matrix needs positive dimensions");
+
+public:
+    typedef elemType value_type;
+
+    constexpr Matrix(): _matrix{} {}
+    constexpr Matrix(int rows, int cols): _matrix{} {
+        if (rows != Rows || cols != Cols) {
+            cerr << "Matrix size mismatch in fixed-size Matrix(rows, cols)" << endl;
+            exit(-1);
+        }
+    }
+    // 按行主序给出全部元素，例如Matrix<int, 2, 2>::from_values(1, 2, 3, 4)
+    template <typename... Ts>
+    static constexpr Matrix from_values(Ts... vals) {
+        static_assert(sizeof...(Ts) == Rows * Cols, "wrong number of elements");
+        return Matrix(Values(), elemType(vals)...);
+    }
+
+    constexpr elemType& operator()(int row, int col) {
+        return _matrix[row * Cols + col];
+    }
+    constexpr const elemType& operator()(int row, int col) const {
+        return _matrix[row * Cols + col];
+    }
+    static constexpr int rows() { return Rows; }
+    static constexpr int cols() { return Cols; }
+    template <int R, int C>
+    static constexpr bool same_size(const Matrix<elemType, R, C> &) {
+        return Rows == R && Cols == C;
+    }
+    template <int R, int C>
+    static constexpr bool comfortable(const Matrix<elemType, R, C> &) {
+        return Cols == R;
+    }
+
+    constexpr void operator+=(const Matrix &rhs) {
+        add_to(rhs, std::make_index_sequence<Rows * Cols>());
+    }
+    ostream& print(ostream &) const;
+
+    constexpr elemType* data() { return _matrix; }
+    constexpr const elemType* data() const { return _matrix; }
+
+private:
+    struct Values {};
+    template <typename... Ts>
+    constexpr Matrix(Values, Ts... vals): _matrix{vals...} {}
+
+    template <size_t... I>
+    constexpr void add_to(const Matrix &rhs, std::index_sequence<I...>) {
+        ((_matrix[I] += rhs._matrix[I]), ...);
+    }
+
+    elemType _matrix[Rows * Cols];
+};
+
+template <typename elemType, int Rows, int Cols>
+ostream& Matrix<elemType, Rows, Cols>::print(ostream &os) const {
+    for (int i = 0; i < Rows * Cols; i++) {
+        if (i % Cols == 0) os << endl;
+        os << _matrix[i] << " ";
+    }
+    os << endl;
+    return os;
+}
+
+// 展开辅助函数：I是结果的行主序下标，K是内积的下标
+template <typename T, int R, int N, int C, size_t... K>
+constexpr T fixed_dot(const Matrix<T, R, N> &m1, const Matrix<T, N, C> &m2, int i, int j,
+                      std::index_sequence<K...>) {
+    return (T() + ... + (m1(i, int(K)) * m2(int(K), j)));
+}
+
+template <typename T, int R, int N, int C, size_t... I>
+constexpr Matrix<T, R, C> fixed_mul(const Matrix<T, R, N> &m1, const Matrix<T, N, C> &m2,
+                                    std::index_sequence<I...>) {
+    return Matrix<T, R, C>::from_values(
+        fixed_dot(m1, m2, int(I) / C, int(I) % C, std::make_index_sequence<N>())...);
+}
+
+template <typename T, int R, int C, size_t... I>
+constexpr Matrix<T, R, C> fixed_scale(const Matrix<T, R, C> &m, const T &s, std::index_sequence<I...>) {
+    return Matrix<T, R, C>::from_values((s * m.data()[I])...);
+}
+
+// 以下运算符只对定长矩阵生效，动态矩阵仍然走上面的表达式模版
+template <typename T, int R, int C>
+constexpr enable_if_t<(R > 0 && C > 0), Matrix<T, R, C> > operator+(const Matrix<T, R, C> &m1, const Matrix<T, R, C> &m2) {
+    Matrix<T, R, C> res(m1);
+    res += m2;
+    return res;
+}
+
+template <typename T, int R1, int C1, int R2, int C2>
+constexpr enable_if_t<(R1 > 0 && C1 > 0 && R2 > 0 && C2 > 0), Matrix<T, R1, C2> > operator*(const Matrix<T, R1, C1> &m1, const Matrix<T, R2, C2> &m2) {
+    static_assert(C1 == R2, "Matrix size mismatch in operator*");
+    return fixed_mul(m1, m2, std::make_index_sequence<R1 * C2>());
+}
+
+template <typename T, int R, int C>
+constexpr enable_if_t<(R > 0 && C > 0), Matrix<T, R, C> > operator*(const Matrix<T, R, C> &m, const T &s) {
+    return fixed_scale(m, s, std::make_index_sequence<R * C>());
+}
+
+template <typename T, int R, int C>
+constexpr enable_if_t<(R > 0 && C > 0), Matrix<T, R, C> > operator*(const T &s, const Matrix<T, R, C> &m) {
+    return fixed_scale(m, s, std::make_index_sequence<R * C>());
+}
+
+// ===== 稀疏矩阵 =====
+// 大部分元素为0的矩阵用CSR（压缩行）格式保存：第i行的非零元位于[_row_ptr[i], _row_ptr[i + 1])，
+// 列号在_col_idx中（每行内递增），数值在_vals中。内存与运算时间都只与非零元个数nnz成正比。
+// 用COO（三元组）格式的CooBuilder逐个添加元素，再build()成CSR。
+template <typename elemType> class SparseMatrix;
+
+template <typename elemType>
+class CooBuilder {
+public:
+    CooBuilder(int rows, int cols): _rows(rows), _cols(cols) {}
+    void reserve(size_t nnz) { _entries.reserve(nnz); }
+    // 同一位置添加多次时数值相加
+    void add(int row, int col, const elemType &val) {
+        if (row < 0 || row >= _rows || col < 0 || col >= _cols) {
+            cerr << "CooBuilder::add: index out of range" << endl;
+            exit(-1);
+        }
+        _entries.push_back(Entry{row, col, val});
+    }
+    SparseMatrix<elemType> build() const;
+
+private:
+    struct Entry {
+        int row, col;
+        elemType val;
+    };
+    int _rows;
+    int _cols;
+    vector<Entry> _entries;
+};
+
+template <typename elemType>
+class SparseMatrix {
+    friend class CooBuilder<elemType>;
+
+public:
+    SparseMatrix(int rows = 0, int cols = 0): _rows(rows), _cols(cols), _row_ptr(rows + 1, 0) {}
+    // 直接给出CSR的三个数组（每行内列号须递增）
+    SparseMatrix(int rows, int cols, vector<int> row_ptr, vector<int> col_idx, vector<elemType> vals):
+    _rows(rows), _cols(cols), _row_ptr(std::move(row_ptr)), _col_idx(std::move(col_idx)), _vals(std::move(vals)) {}
+    // 由稠密矩阵构造，只保留非零元
+    explicit SparseMatrix(const Matrix<elemType> &);
+
+    int rows() const { return _rows; }
+    int cols() const { return _cols; }
+    size_t nnz() const { return _vals.size(); }
+    bool same_size(const SparseMatrix &m) const { return _rows == m._rows && _cols == m._cols; }
+    // 第row行、第col列的元素（按列号二分查找）
+    elemType operator()(int row, int col) const;
+
+    Matrix<elemType> to_dense() const;
+    ostream& print(ostream &) const;
+
+    const vector<int>& row_ptr() const { return _row_ptr; }
+    const vector<int>& col_idx() const { return _col_idx; }
+    const vector<elemType>& values() const { return _vals; }
+
+private:
+    int _rows;
+    int _cols;
+    vector<int> _row_ptr;
+    vector<int> _col_idx;
+    vector<elemType> _vals;
+};
+
+template <typename elemType>
+SparseMatrix<elemType> CooBuilder<elemType>::build() const {
+    // 先按行计数排序，再在每一行内按列排序并合并重复项
+    SparseMatrix<elemType> res(_rows, _cols);
+    vector<int> start(_rows + 1, 0);
+    for (const Entry &e : _entries) start[e.row + 1]++;
+    for (int i = 0; i < _rows; i++) start[i + 1] += start[i];
+    vector<Entry> by_row(_entries.size());
+    vector<int> pos(start.begin(), start.end() - 1);
+    for (const Entry &e : _entries) by_row[pos[e.row]++] = e;
+
+    res._col_idx.reserve(_entries.size());
+    res._vals.reserve(_entries.size());
+    for (int i = 0; i < _rows; i++) {
+        auto first = by_row.begin() + start[i], last = by_row.begin() + start[i + 1];
+        stable_sort(first, last, [](const Entry &a, const Entry &b) { return a.col < b.col; });
+        for (auto it = first; it != last; ++it) {
+            if (int(res._vals.size()) > res._row_ptr[i] && res._col_idx.back() == it->col)
+                res._vals.back() += it->val;
+            else {
+                res._col_idx.push_back(it->col);
+                res._vals.push_back(it->val);
+            }
+        }
+        res._row_ptr[i + 1] = int(res._vals.size());
+    }
+    return res;
+}
+
+template <typename elemType>
+SparseMatrix<elemType>::SparseMatrix(const Matrix<elemType> &m):
+_rows(m.rows()), _cols(m.cols()), _row_ptr(m.rows() + 1, 0) {
+    for (int i = 0; i < _rows; i++) {
+        for (int j = 0; j < _cols; j++) {
+            if (m(i, j) != elemType()) {
+                _col_idx.push_back(j);
+                _vals.push_back(m(i, j));
+            }
+        }
+        _row_ptr[i + 1] = int(_vals.size());
+    }
+}
+
+template <typename elemType>
+elemType SparseMatrix<elemType>::operator()(int row, int col) const {
+    auto first = _col_idx.begin() + _row_ptr[row], last = _col_idx.begin() + _row_ptr[row + 1];
+    auto it = lower_bound(first, last, col);
+    return it != last && *it == col ? _vals[it - _col_idx.begin()] : elemType();
+}
+
+template <typename elemType>
+Matrix<elemType> SparseMatrix<elemType>::to_dense() const {
+    Matrix<elemType> res(_rows, _cols);
+    for (int i = 0; i < _rows; i++)
+        for (int p = _row_ptr[i]; p < _row_ptr[i + 1]; p++) res(i, _col_idx[p]) = _vals[p];
+    return res;
+}
+
+template <typename elemType>
+ostream& SparseMatrix<elemType>::print(ostream &os) const {
+    for (int i = 0; i < _rows; i++)
+        for (int p = _row_ptr[i]; p < _row_ptr[i + 1]; p++)
+            os << "(" << i << ", " << _col_idx[p] << ") " << _vals[p] << endl;
+    return os;
+}
+
+template <typename elemType>
+inline ostream& operator<<(ostream &os, const SparseMatrix<elemType> &m) {
+    return m.print(os);
+}
+
+// 稀疏矩阵 * 稠密向量
+template <typename elemType>
+vector<elemType> operator*(const SparseMatrix<elemType> &s, const vector<elemType> &x) {
+    if (s.cols() != int(x.size())) {
+        cerr << "Matrix size mismatch in operator*" << endl;
+        exit(-1);
+    }
+    vector<elemType> y(s.rows());
+    const int *rp = s.row_ptr().data(), *ci = s.col_idx().data();
+    const elemType *v = s.values().data();
+    // 每段行至少覆盖约64K个非零元才值得并行
+    long grain = max(1L, (1L << 16) * s.rows() / max(1L, long(s.nnz())));
+    par_range(s.rows(), [&](long begin, long end) {
+        for (long i = begin; i < end; i++) {
+            elemType sum = elemType();
+            for (int p = rp[i]; p < rp[i + 1]; p++) sum += v[p] * x[ci[p]];
+            y[i] = sum;
+        }
+    }, grain);
+    return y;
+}
+
+// 稀疏矩阵 * 稠密矩阵：结果的第i行是B中若干行的线性组合，全部按行连续访问
+template <typename elemType>
+Matrix<elemType> operator*(const SparseMatrix<elemType> &s, const Matrix<elemType> &b) {
+    if (s.cols() != b.rows()) {
+        cerr << "Matrix size mismatch in operator*" << endl;
+        exit(-1);
+    }
+    Matrix<elemType> res(s.rows(), b.cols());
+    const int *rp = s.row_ptr().data(), *ci = s.col_idx().data();
+    const elemType *v = s.values().data(), *bd = b.data();
+    elemType *cd = res.data();
+    int n = b.cols();
+    long work_per_row = max(1L, long(s.nnz()) * n / max(1, s.rows()));
+    par_range(s.rows(), [&](long begin, long end) {
+        for (long i = begin; i < end; i++) {
+            elemType *c = cd + i * n;
+            for (int p = rp[i]; p < rp[i + 1]; p++) {
+                const elemType *brow = bd + long(ci[p]) * n;
+                elemType a = v[p];
+                for (int j = 0; j < n; j++) c[j] += a * brow[j];
+            }
+        }
+    }, max(1L, (1L << 16) / work_per_row));
+    return res;
+}
+
+// 稀疏矩阵 + 稀疏矩阵：逐行归并两个有序的列号序列，和为0的位置不再保存
+template <typename elemType>
+SparseMatrix<elemType> operator+(const SparseMatrix<elemType> &m1, const SparseMatrix<elemType> &m2) {
+    if (!m1.same_size(m2)) {
+        cerr << "Matrix size mismatch in operator+" << endl;
+        exit(-1);
+    }
+    vector<int> row_ptr(m1.rows() + 1, 0), col_idx;
+    vector<elemType> vals;
+    col_idx.reserve(m1.nnz() + m2.nnz());
+    vals.reserve(m1.nnz() + m2.nnz());
+    const vector<int> &r1 = m1.row_ptr(), &r2 = m2.row_ptr(), &c1 = m1.col_idx(), &c2 = m2.col_idx();
+    const vector<elemType> &v1 = m1.values(), &v2 = m2.values();
+    for (int i = 0; i < m1.rows(); i++) {
+        int p = r1[i], q = r2[i];
+        while (p < r1[i + 1] || q < r2[i + 1]) {
+            if (q == r2[i + 1] || (p < r1[i + 1] && c1[p] < c2[q])) {
+                col_idx.push_back(c1[p]);
+                vals.push_back(v1[p++]);
+            } else if (p == r1[i + 1] || c2[q] < c1[p]) {
+                col_idx.push_back(c2[q]);
+                vals.push_back(v2[q++]);
+            } else {
+                elemType sum = v1[p] + v2[q];
+                if (sum != elemType()) {
+                    col_idx.push_back(c1[p]);
+                    vals.push_back(sum);
+                }
+                p++;
+                q++;
+            }
+        }
+        row_ptr[i + 1] = int(vals.size());
+    }
+    return SparseMatrix<elemType>(m1.rows(), m1.cols(), std::move(row_ptr), std::move(col_idx), std::move(vals));
+}
+
+// ===== 磁盘文件 =====
+// 以二进制格式保存/读取矩阵（格式见matrix/MatrixFile.h），以及直接把文件mmap成矩阵视图。
+// MappedMatrix不拷贝数据：页面在第一次访问时才由内核从文件读入，内存不够时也可以被换出，
+// 因此比内存还大的矩阵同样可以打开，它的view()可以出现在任何表达式中。
+
+// T为const elemType时只读映射；否则以MAP_SHARED可写映射，对view()的写入会写回文件
+template <typename T>
+class MappedMatrix {
+public:
+    typedef typename remove_const<T>::type value_type;
+    static const bool writable = !is_const<T>::value;
+
+    explicit MappedMatrix(const char *path) {
+        matfile::MatrixFile<value_type> file(path, writable);
+        _rows = int(file.rows());
+        _cols = int(file.cols());
+        _length = size_t(file.file_size());
+        _base = mmap(nullptr, _length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file.fd(), 0);
+        if (_base == MAP_FAILED) matfile::fail("cannot mmap", path);
+        // 文件描述符关闭后映射仍然有效
+        _data = reinterpret_cast<T *>(static_cast<char *>(_base) + file.data_offset());
+    }
+    MappedMatrix(MappedMatrix &&rhs) noexcept:
+    _rows(rhs._rows), _cols(rhs._cols), _length(rhs._length), _base(rhs._base), _data(rhs._data) {
+        rhs._base = nullptr;
+        rhs._length = 0;
+    }
+    MappedMatrix(const MappedMatrix &) = delete;
+    MappedMatrix& operator=(const MappedMatrix &) = delete;
+    ~MappedMatrix() { if (_base) munmap(_base, _length); }
+
+    int rows() const { return _rows; }
+    int cols() const { return _cols; }
+    T* data() const { return _data; }
+    T& operator()(int row, int col) const { return _data[long(row) * _cols + col]; }
+    MatrixView<T> view() const { return MatrixView<T>(_data, _rows, _cols, _cols, 1); }
+    // 把写入的数据刷回文件
+    void sync() const { if (writable) msync(_base, _length, MS_SYNC); }
+
+private:
+    int _rows;
+    int _cols;
+    size_t _length;
+    void *_base;
+    T *_data;
+};
+
+template <typename elemType>
+void save_matrix(const char *path, const Matrix<elemType> &m) {
+    matfile::MatrixFile<elemType> file(path, m.rows(), m.cols());
+    file.write_block(0, 0, m.rows(), m.cols(), m.data(), m.cols());
+}
+
+// 视图逐行写入，列步长不为1（如转置视图）时先把一行收集到缓冲区
+template <typename T>
+void save_matrix(const char *path, const MatrixView<T> &v) {
+    typedef typename MatrixView<T>::value_type elemType;
+    matfile::MatrixFile<elemType> file(path, v.rows(), v.cols());
+    vector<elemType> row(v.col_stride() == 1 ? 0 : v.cols());
+    for (int i = 0; i < v.rows(); i++) {
+        const elemType *src = v.data() + i * v.row_stride();
+        if (v.col_stride() != 1) {
+            for (int j = 0; j < v.cols(); j++) row[j] = v.at(i, j);
+            src = row.data();
+        }
+        file.write_block(i, 0, 1, v.cols(), src, v.cols());
+    }
+}
+
+// 其它表达式先求值
+template <typename E>
+void save_matrix(const char *path, const MatExpr<E> &e) {
+    save_matrix(path, Matrix<typename E::value_type>(e));
+}
+
+template <typename elemType>
+Matrix<elemType> load_matrix(const char *path) {
+    matfile::MatrixFile<elemType> file(path);
+    Matrix<elemType> m(int(file.rows()), int(file.cols()));
+    file.read_block(0, 0, m.rows(), m.cols(), m.data(), m.cols());
+    return m;
+}
+
+// 常驻的读取线程：request(s)让它在后台执行load(s)，wait()等到这次读完。同一时刻最多只有一个请求。
+// 线程在构造时创建、析构时结束，不必每读一块就创建一个线程
+template <typename Load>
+class BackgroundLoader {
+public:
+    explicit BackgroundLoader(Load load): _load(load), _thread([this] { run(); }) {}
+    BackgroundLoader(const BackgroundLoader &) = delete;
+    BackgroundLoader& operator=(const BackgroundLoader &) = delete;
+    ~BackgroundLoader() {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+
+    void request(int64_t s) {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _next = s;
+            _requested = true;
+            _busy = true;
+        }
+        _cv.notify_all();
+    }
+    void wait() {
+        unique_lock<mutex> lock(_mutex);
+        _cv.wait(lock, [this] { return !_busy; });
+    }
+
+private:
+    void run() {
+        unique_lock<mutex> lock(_mutex);
+        for (;;) {
+            _cv.wait(lock, [this] { return _stop || _requested; });
+            if (_stop) return;
+            _requested = false;
+            int64_t s = _next;
+            lock.unlock();
+            _load(s);
+            lock.lock();
+            _busy = false;
+            _cv.notify_all();
+        }
+    }
+
+    Load _load;
+    mutex _mutex;
+    condition_variable _cv;
+    int64_t _next = 0;
+    bool _requested = false;
+    bool _busy = false;
+    bool _stop = false;
+    thread _thread;         // 最后初始化：线程启动时其它成员都已就绪
+};
+
+// 外存分块乘法：文件c_path = a_path * b_path，三个矩阵都不必放进内存。
+// C按t*t的块计算，每块沿k方向依次读入A、B的t*t块并累加，最后整块写回；
+// A、B的块有两套缓冲区，常驻的读取线程读下一对块的同时线程池在计算当前这一对，I/O与计算重叠。
+// 总共只占用5 * t * t个元素，t由内存预算budget（字节）决定。
+template <typename elemType>
+void multiply_out_of_core(const char *a_path, const char *b_path, const char *c_path,
+                          size_t budget = size_t(256) << 20) {
+    matfile::MatrixFile<elemType> a(a_path), b(b_path);
+    if (a.cols() != b.rows()) {
+        cerr << "Matrix size mismatch in multiply_out_of_core" << endl;
+        exit(-1);
+    }
+    int64_t m = a.rows(), n = b.cols(), k = a.cols();
+    matfile::MatrixFile<elemType> c(c_path, m, n);
+    if (m == 0 || n == 0) return;
+
+    long t = 1;
+    while (5 * (2 * t) * (2 * t) * sizeof(elemType) <= budget) t *= 2;
+    t = max(1L, min<long>(t, max(m, max(n, k))));
+    vector<elemType> c_buf(t * t), a_buf[2], b_buf[2];
+    for (int s = 0; s < 2; s++) {
+        a_buf[s].resize(t * t);
+        b_buf[s].resize(t * t);
+    }
+
+    int64_t mt = (m + t - 1) / t, nt = (n + t - 1) / t, kt = max<int64_t>(1, (k + t - 1) / t);
+    int64_t steps = mt * nt * kt;
+    // 第s步计算C块(i, j)的第p个k块
+    auto load = [&](int64_t s, int slot) {
+        int64_t i = s / (nt * kt) * t, j = s / kt % nt * t, p = s % kt * t;
+        int rows = int(min<int64_t>(t, m - i)), cols = int(min<int64_t>(t, n - j)), depth = int(min<int64_t>(t, k - p));
+        a.read_block(i, p, rows, depth, a_buf[slot].data(), t);
+        b.read_block(p, j, depth, cols, b_buf[slot].data(), t);
+    };
+    load(0, 0);
+    auto load_next = [&](int64_t s) { load(s, int(s & 1)); };
+    BackgroundLoader<decltype(load_next)> prefetch(load_next);
+    for (int64_t s = 0; s < steps; s++) {
+        if (s + 1 < steps) prefetch.request(s + 1);
+        int64_t i = s / (nt * kt) * t, j = s / kt % nt * t, p = s % kt * t;
+        int rows = int(min<int64_t>(t, m - i)), cols = int(min<int64_t>(t, n - j)), depth = int(min<int64_t>(t, k - p));
+        int slot = int(s & 1);
+        par_gemm(rows, cols, depth, elemType(1), a_buf[slot].data(), t, 1L, b_buf[slot].data(), t, 1L,
+                 p == 0 ? elemType() : elemType(1), c_buf.data(), t, 1L);
+        if (p + t >= k) c.write_block(i, j, rows, cols, c_buf.data(), t);
+        prefetch.wait();
+    }
+}
+
+// ===== 批量小矩阵 =====
+// 大量同样形状的小矩阵（4*4、8*8）逐个用Matrix<elemType>计算时，时间都花在new[]、指针跳转
+// 以及为大矩阵设计的打包上。MatrixBatch把count个矩阵按组交错存放（AoSoA）：
+// 每组L = simd::batch_lanes<elemType>()个矩阵，组内同一位置(i, j)的L个元素连续存放（一个缓存行）。
+// 于是批量加法就是整段数组相加，批量乘法则沿批量方向向量化，一条向量指令同时算出L个矩阵的同一个元素。
+// 最后一组不足L个矩阵时补0。
+template <typename elemType>
+class MatrixBatch {
+public:
+    static const int LANES = simd::batch_lanes<elemType>();
+
+    MatrixBatch(int count, int rows, int cols):
+    _count(count), _rows(rows), _cols(cols), _data(size_t((count + LANES - 1) / LANES) * rows * cols * LANES) {}
+
+    int count() const { return _count; }
+    int rows() const { return _rows; }
+    int cols() const { return _cols; }
+    int groups() const { return (_count + LANES - 1) / LANES; }
+    bool same_size(const MatrixBatch &m) const {
+        return _count == m._count && _rows == m._rows && _cols == m._cols;
+    }
+
+    // 第b个矩阵的元素(row, col)
+    elemType& operator()(int b, int row, int col) { return _data[index(b, row, col)]; }
+    const elemType& operator()(int b, int row, int col) const { return _data[index(b, row, col)]; }
+    void set(int b, const Matrix<elemType> &m);
+    Matrix<elemType> get(int b) const;
+
+    void operator+=(const MatrixBatch &);
+    // 第g组的起始地址
+    elemType* group(int g) { return _data.data() + size_t(g) * _rows * _cols * LANES; }
+    const elemType* group(int g) const { return _data.data() + size_t(g) * _rows * _cols * LANES; }
+
+private:
+    size_t index(int b, int row, int col) const {
+        return (size_t(b / LANES) * _rows * _cols + row * _cols + col) * LANES + b % LANES;
+    }
+
+    int _count;
+    int _rows;
+    int _cols;
+    vector<elemType> _data;
+};
+
+template <typename elemType>
+void MatrixBatch<elemType>::set(int b, const Matrix<elemType> &m) {
+    if (m.rows() != _rows || m.cols() != _cols) {
+        cerr << "Matrix size mismatch in MatrixBatch::set" << endl;
+        exit(-1);
+    }
+    for (int i = 0; i < _rows; i++)
+        for (int j = 0; j < _cols; j++) (*this)(b, i, j) = m(i, j);
+}
+
+template <typename elemType>
+Matrix<elemType> MatrixBatch<elemType>::get(int b) const {
+    Matrix<elemType> m(_rows, _cols);
+    for (int i = 0; i < _rows; i++)
+        for (int j = 0; j < _cols; j++) m(i, j) = (*this)(b, i, j);
+    return m;
+}
+
+template <typename elemType>
+void MatrixBatch<elemType>::operator+=(const MatrixBatch<elemType> &rhs) {
+    if (!same_size(rhs)) {
+        cerr << "Matrix size mismatch in MatrixBatch::operator+=" << endl;
+        exit(-1);
+    }
+    // 两边布局相同，整段交给SIMD加法内核
+    int len = _rows * _cols * LANES;
+    par_add(groups(), len, _data.data(), len, rhs._data.data(), len);
+}
+
+template <typename elemType>
+MatrixBatch<elemType> operator+(const MatrixBatch<elemType> &m1, const MatrixBatch<elemType> &m2) {
+    MatrixBatch<elemType> res(m1);
+    res += m2;
+    return res;
+}
+
+// res中的每个矩阵 = m1 * m2中对应的矩阵。res的形状已经正确时不分配内存
+template <typename elemType>
+void batch_multiply(const MatrixBatch<elemType> &m1, const MatrixBatch<elemType> &m2, MatrixBatch<elemType> &res) {
+    if (m1.count() != m2.count() || m1.cols() != m2.rows()) {
+        cerr << "Matrix size mismatch in batch_multiply" << endl;
+        exit(-1);
+    }
+    if (&res == &m1 || &res == &m2) {
+        MatrixBatch<elemType> tmp(m1.count(), m1.rows(), m2.cols());
+        batch_multiply(m1, m2, tmp);
+        res = std::move(tmp);
+        return;
+    }
+    if (res.count() != m1.count() || res.rows() != m1.rows() || res.cols() != m2.cols())
+        res = MatrixBatch<elemType>(m1.count(), m1.rows(), m2.cols());
+    int m = m1.rows(), n = m2.cols(), k = m1.cols();
+    long grain = max(1L, (1L << 16) / max(1L, long(m) * n * k * MatrixBatch<elemType>::LANES));
+    par_range(m1.groups(), [&](long begin, long end) {
+        for (long g = begin; g < end; g++) vec_batch_mul(m, n, k, m1.group(int(g)), m2.group(int(g)), res.group(int(g)));
+    }, grain);
+}
+
+template <typename elemType>
+MatrixBatch<elemType> operator*(const MatrixBatch<elemType> &m1, const MatrixBatch<elemType> &m2) {
+    MatrixBatch<elemType> res(m1.count(), m1.rows(), m2.cols());
+    batch_multiply(m1, m2, res);
+    return res;
+}
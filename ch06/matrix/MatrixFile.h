@@ -0,0 +1,158 @@
+#ifndef CODING_MATRIXFILE_H
+#define CODING_MATRIXFILE_H
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// 矩阵的二进制文件格式（本机字节序）：
+//   [0, 64)              Header：魔数、版本、元素类型、元素大小、对齐、行数、列数、数据区偏移
+//   [data_offset, ...)   rows * cols个元素，行主序，中间没有填充
+// 数据区偏移对齐到ALIGNMENT（一页），因此整个文件mmap之后数据区可以直接当作矩阵使用，
+// 也可以用pread/pwrite按块读写，不需要把整个矩阵放进内存。
+// 文本形式的print()既慢又会丢失浮点精度，保存矩阵应使用这个格式。
+
+namespace matfile {
+
+const char MAGIC[8] = {'C', 'O', 'D', 'M', 'A', 'T', 'R', 'X'};
+const uint32_t VERSION = 1;
+const uint32_t ALIGNMENT = 4096;
+
+enum Dtype: uint32_t { UNKNOWN = 0, FLOAT32 = 1, FLOAT64 = 2, INT32 = 3, INT64 = 4 };
+
+template <typename T> struct dtype_of { static const uint32_t value = UNKNOWN; };
+template <> struct dtype_of<float> { static const uint32_t value = FLOAT32; };
+template <> struct dtype_of<double> { static const uint32_t value = FLOAT64; };
+template <> struct dtype_of<int32_t> { static const uint32_t value = INT32; };
+template <> struct dtype_of<int64_t> { static const uint32_t value = INT64; };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    uint32_t elem_size;
+    uint32_t alignment;
+    int64_t rows;
+    int64_t cols;
+    uint64_t data_offset;
+    uint64_t reserved[2];
+};
+static_assert(sizeof(Header) == 64, "matfile::Header must be 64 bytes");
+
+inline void fail(const char *what, const char *path) {
+    std::cerr << "MatrixFile: " << what << ": " << path << std::endl;
+    std::exit(-1);
+}
+
+// 一个已打开的矩阵文件。按块读写的偏移都以元素为单位
+template <typename T>
+class MatrixFile {
+public:
+    static_assert(dtype_of<T>::value != UNKNOWN, "MatrixFile supports float, double, int32_t and int64_t");
+
+    // 打开已有的文件，检查头部与元素类型
+    explicit MatrixFile(const char *path, bool writable = false) {
+        _fd = ::open(path, writable ? O_RDWR : O_RDONLY);
+        if (_fd < 0) fail("cannot open", path);
+        if (::pread(_fd, &_header, sizeof(_header), 0) != ssize_t(sizeof(_header))) fail("truncated header", path);
+        if (std::memcmp(_header.magic, MAGIC, sizeof(MAGIC)) != 0) fail("not a matrix file", path);
+        if (_header.version != VERSION) fail("unsupported version", path);
+        if (_header.dtype != dtype_of<T>::value || _header.elem_size != sizeof(T)) fail("element type mismatch", path);
+        // 数据区偏移要对齐到元素大小，mmap之后才能直接当作T*使用；元素个数和文件大小不能溢出
+        if (_header.rows < 0 || _header.cols < 0 || _header.data_offset < sizeof(Header) ||
+            _header.data_offset % sizeof(T) != 0 || !size_fits(_header)) fail("corrupt header", path);
+        struct stat st;
+        if (::fstat(_fd, &st) != 0 || uint64_t(st.st_size) < file_size()) fail("truncated data", path);
+    }
+    // 新建（或截断）文件，数据区全部为0
+    MatrixFile(const char *path, int64_t rows, int64_t cols) {
+        _fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (_fd < 0) fail("cannot create", path);
+        std::memset(&_header, 0, sizeof(_header));
+        std::memcpy(_header.magic, MAGIC, sizeof(MAGIC));
+        _header.version = VERSION;
+        _header.dtype = dtype_of<T>::value;
+        _header.elem_size = sizeof(T);
+        _header.alignment = ALIGNMENT;
+        _header.rows = rows;
+        _header.cols = cols;
+        _header.data_offset = ALIGNMENT;
+        if (rows < 0 || cols < 0 || !size_fits(_header)) fail("matrix too large", path);
+        if (::pwrite(_fd, &_header, sizeof(_header), 0) != ssize_t(sizeof(_header)) ||
+            ::ftruncate(_fd, off_t(file_size())) != 0) fail("cannot write", path);
+    }
+    MatrixFile(MatrixFile &&rhs) noexcept: _fd(rhs._fd), _header(rhs._header) { rhs._fd = -1; }
+    MatrixFile(const MatrixFile &) = delete;
+    MatrixFile& operator=(const MatrixFile &) = delete;
+    ~MatrixFile() { if (_fd >= 0) ::close(_fd); }
+
+    int64_t rows() const { return _header.rows; }
+    int64_t cols() const { return _header.cols; }
+    int fd() const { return _fd; }
+    uint64_t data_offset() const { return _header.data_offset; }
+    // 构造时已经检查过不会溢出
+    uint64_t file_size() const { return _header.data_offset + uint64_t(_header.rows) * uint64_t(_header.cols) * sizeof(T); }
+
+    // dst(rows×cols，行步长ld) = 文件中从(row, col)开始的块
+    void read_block(int64_t row, int64_t col, int rows, int cols, T *dst, long ld) const {
+        block_io(row, col, rows, cols, dst, ld, false);
+    }
+    // 文件中从(row, col)开始的块 = src(rows×cols，行步长ld)
+    void write_block(int64_t row, int64_t col, int rows, int cols, const T *src, long ld) {
+        block_io(row, col, rows, cols, const_cast<T *>(src), ld, true);
+    }
+
+private:
+    // data_offset + rows * cols * sizeof(T)在uint64_t中不溢出，而且不超过off_t的范围
+    static bool size_fits(const Header &h) {
+        const uint64_t limit = uint64_t(INT64_MAX);
+        uint64_t rows = uint64_t(h.rows), cols = uint64_t(h.cols);
+        if (h.data_offset > limit) return false;
+        if (cols != 0 && rows > limit / cols) return false;
+        return rows * cols <= (limit - h.data_offset) / sizeof(T);
+    }
+
+    void block_io(int64_t row, int64_t col, int rows, int cols, T *buf, long ld, bool write) const {
+        if (row < 0 || col < 0 || row + rows > _header.rows || col + cols > _header.cols) {
+            std::cerr << "MatrixFile: block out of range" << std::endl;
+            std::exit(-1);
+        }
+        // 整行的块在文件和内存中都连续时，一次读写完成
+        if (cols == _header.cols && ld == cols) {
+            transfer(buf, size_t(rows) * cols * sizeof(T), offset(row, 0), write);
+            return;
+        }
+        for (int i = 0; i < rows; i++)
+            transfer(buf + i * ld, size_t(cols) * sizeof(T), offset(row + i, col), write);
+    }
+
+    off_t offset(int64_t row, int64_t col) const {
+        return off_t(_header.data_offset + (uint64_t(row) * uint64_t(_header.cols) + uint64_t(col)) * sizeof(T));
+    }
+
+    // pread/pwrite可能只完成一部分，循环直到全部完成
+    void transfer(T *buf, size_t bytes, off_t off, bool write) const {
+        char *p = reinterpret_cast<char *>(buf);
+        while (bytes > 0) {
+            ssize_t done = write ? ::pwrite(_fd, p, bytes, off) : ::pread(_fd, p, bytes, off);
+            if (done <= 0) {
+                std::cerr << "MatrixFile: I/O error" << std::endl;
+                std::exit(-1);
+            }
+            p += done;
+            off += done;
+            bytes -= size_t(done);
+        }
+    }
+
+    int _fd;
+    Header _header;
+};
+
+}
+
+#endif //CODING_MATRIXFILE_H
@@ -0,0 +1,173 @@
+#ifndef CODING_THREADPOOL_H
+#define CODING_THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+
+// 常驻的work-stealing线程池。
+// 每个工作线程有自己的任务队列：从队尾取自己的任务，自己的队列空了就从别人的队首偷。
+// parallel_for把n个任务轮流分发到各个队列，调用线程也参与执行，直到所有任务完成才返回。
+// 线程只在构造和set_threads()时创建，每次调用不再创建线程，任务本身也不做堆分配。
+class ThreadPool {
+public:
+    // 全局线程池。线程数取环境变量MATRIX_THREADS，没有设置则取硬件线程数
+    static ThreadPool& global() {
+        static ThreadPool pool(default_threads());
+        return pool;
+    }
+
+    explicit ThreadPool(int threads = 1) { start(threads); }
+    ~ThreadPool() { stop(); }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    // 参与计算的线程总数（包括调用parallel_for的线程）
+    int threads() const { return int(_workers.size()) + 1; }
+    // 不能在parallel_for执行期间调用
+    void set_threads(int n) {
+        if (n < 1) n = 1;
+        if (n == threads()) return;
+        stop();
+        start(n);
+    }
+
+    // 对[0, n)中的每一个i调用f(i)，返回时全部完成
+    template <typename Func>
+    void parallel_for(int n, Func f) {
+        if (n <= 0) return;
+        if (_workers.empty() || n == 1) {
+            for (int i = 0; i < n; i++) f(i);
+            return;
+        }
+        Job job;
+        job.run = [](void *ctx, int i) { (*static_cast<Func *>(ctx))(i); };
+        job.ctx = &f;
+        job.remaining = n;
+        for (int i = 0; i < n; i++) {
+            Queue &q = *_queues[i % _queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            q.tasks.push_back(Task{&job, i});
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending += n;
+        }
+        _cv.notify_all();
+
+        // 调用线程也去偷任务执行
+        Task t;
+        while (job.remaining.load() > 0) {
+            if (steal(0, t)) execute(t);
+            else {
+                std::unique_lock<std::mutex> lock(_done_mutex);
+                _done_cv.wait(lock, [&] { return job.remaining.load() == 0; });
+            }
+        }
+    }
+
+private:
+    struct Job {
+        void (*run)(void *, int);
+        void *ctx;
+        std::atomic<int> remaining;
+    };
+    struct Task {
+        Job *job;
+        int index;
+    };
+    // 用vector加队首下标实现的双端队列：队列空时复位，容量保留下来，稳定后不再分配内存
+    struct Queue {
+        std::mutex m;
+        std::vector<Task> tasks;
+        size_t head = 0;
+    };
+
+    static int default_threads() {
+        if (const char *env = std::getenv("MATRIX_THREADS")) {
+            int n = std::atoi(env);
+            if (n > 0) return n;
+        }
+        int n = int(std::thread::hardware_concurrency());
+        return n > 0 ? n : 1;
+    }
+
+    void start(int n) {
+        _stop = false;
+        _pending = 0;
+        for (int i = 0; i + 1 < n; i++) _queues.emplace_back(new Queue);
+        for (int i = 0; i + 1 < n; i++) _workers.emplace_back([this, i] { work(i); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto &w : _workers) w.join();
+        _workers.clear();
+        _queues.clear();
+    }
+
+    // 先从自己的队尾取，再从其它队列的队首偷
+    bool steal(int self, Task &t) {
+        int n = int(_queues.size());
+        for (int k = 0; k < n; k++) {
+            Queue &q = *_queues[(self + k) % n];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.head == q.tasks.size()) continue;
+            if (k == 0) {
+                t = q.tasks.back();
+                q.tasks.pop_back();
+            } else {
+                t = q.tasks[q.head++];
+            }
+            if (q.head == q.tasks.size()) {
+                q.tasks.clear();
+                q.head = 0;
+            }
+            std::lock_guard<std::mutex> lock2(_mutex);
+            _pending--;
+            return true;
+        }
+        return false;
+    }
+
+    void execute(const Task &t) {
+        Job *job = t.job;
+        job->run(job->ctx, t.index);
+        if (--job->remaining == 0) {
+            std::lock_guard<std::mutex> lock(_done_mutex);
+            _done_cv.notify_all();
+        }
+    }
+
+    void work(int self) {
+        Task t;
+        for (;;) {
+            if (steal(self, t)) {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this] { return _stop || _pending > 0; });
+            if (_stop) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;                   // 保护_pending和_stop
+    std::condition_variable _cv;
+    int _pending = 0;
+    bool _stop = false;
+    std::mutex _done_mutex;
+    std::condition_variable _done_cv;
+};
+
+#endif //CODING_THREADPOOL_H
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include "../6-2.cpp"
+using namespace std;
+
+// 统计一串+/*运算实际发生的堆分配次数，并与它产生的结果矩阵个数比较。
+// 打包缓冲区和线程池队列只在第一次使用时分配，因此先预热再计数。
+// 默认单线程运行，使每次计数都落在同一个线程上；用法：bench_alloc [threads=1]
+
+static atomic<long> alloc_count(0);
+
+static void* counted_malloc(size_t n) {
+    alloc_count++;
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new(size_t n) { return counted_malloc(n); }
+void* operator new[](size_t n) { return counted_malloc(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+int failures = 0;
+
+// 运行f两次预热，第三次计数；results为这条表达式应产生的结果矩阵个数
+template <typename Func>
+void check(const string &what, int results, Func f) {
+    f();
+    f();
+    long before = alloc_count;
+    f();
+    long used = alloc_count - before;
+    bool ok = used <= results;
+    if (!ok) failures++;
+    cout << left << setw(32) << what << right << setw(6) << used << " alloc(s), "
+         << setw(2) << results << " result(s)  " << (ok ? "ok" : "FAILED") << endl;
+}
+
+int main(int argc, char *argv[]) {
+    ThreadPool::global().set_threads(argc > 1 ? atoi(argv[1]) : 1);
+    const int n = 256;
+    Matrix<double> a(n, n), b(n, n), c(n, n), d(n, n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            a(i, j) = i + j;
+            b(i, j) = i - j;
+            c(i, j) = 1;
+        }
+
+    check("Matrix r = a + b", 1, [&] { Matrix<double> r = a + b; });
+    check("Matrix r = a + b + c * 2.0", 1, [&] { Matrix<double> r = a + b + c * 2.0; });
+    check("Matrix r = a * b", 1, [&] { Matrix<double> r = a * b; });
+    check("Matrix r = a * b + c", 1, [&] { Matrix<double> r = a * b + c; });
+    check("Matrix r = a * b * c", 2, [&] { Matrix<double> r = a * b * c; });
+    check("Matrix r = (a + b) * c", 2, [&] { Matrix<double> r = (a + b) * c; });
+    check("d = a + b + c", 0, [&] { d = a + b + c; });
+    check("d = a * b + c", 0, [&] { d = a * b + c; });
+    check("d += a * b", 0, [&] { d += a * b; });
+    check("d = a * d (aliased)", 1, [&] { d = a * d; });
+    check("d = Matrix(a) (move)", 1, [&] { d = Matrix<double>(a); });
+    check("Matrix r(move(copy))", 1, [&] { Matrix<double> t(a); Matrix<double> r(std::move(t)); });
+
+    cout << (failures ? "FAILED" : "all ok") << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "../6-2.cpp"
+using namespace std;
+
+// 大量独立的N*N小矩阵相乘/相加：对比逐个Matrix<T>计算、逐个定长Matrix<T, N, N>计算与MatrixBatch<T>批量计算。
+// 三种方式的结果逐个比较，必须完全一致。
+// 默认单线程运行，只比较数据布局本身带来的差别；用法：bench_batch [count=1000000] [threads=1]
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename T, int N>
+bool bench(const char *type_name, int count) {
+    vector<Matrix<T>> a, b, c;
+    vector<Matrix<T, N, N>> fa(count), fb(count), fc(count);
+    MatrixBatch<T> ba(count, N, N), bb(count, N, N), bc(count, N, N);
+    a.reserve(count);
+    b.reserve(count);
+    c.reserve(count);
+    for (int x = 0; x < count; x++) {
+        a.emplace_back(N, N);
+        b.emplace_back(N, N);
+        c.emplace_back(N, N);
+        for (int i = 0; i < N; i++)
+            for (int j = 0; j < N; j++) {
+                a[x](i, j) = fa[x](i, j) = ba(x, i, j) = T((x + i * 3 + j) % 7) / T(4);
+                b[x](i, j) = fb[x](i, j) = bb(x, i, j) = T((x * 5 + i + j * 2) % 5) / T(2);
+            }
+    }
+
+    double mul_obj = seconds([&] { for (int x = 0; x < count; x++) c[x] = a[x] * b[x]; });
+    double mul_fixed = seconds([&] { for (int x = 0; x < count; x++) fc[x] = fa[x] * fb[x]; });
+    double mul_batch = seconds([&] { batch_multiply(ba, bb, bc); });
+    bool ok = true;
+    for (int x = 0; x < count; x++)
+        for (int i = 0; i < N; i++)
+            for (int j = 0; j < N; j++) ok = ok && c[x](i, j) == bc(x, i, j) && fc[x](i, j) == bc(x, i, j);
+
+    double add_obj = seconds([&] { for (int x = 0; x < count; x++) a[x] += b[x]; });
+    double add_fixed = seconds([&] { for (int x = 0; x < count; x++) fa[x] += fb[x]; });
+    double add_batch = seconds([&] { ba += bb; });
+    for (int x = 0; x < count; x++) ok = ok && a[x](N - 1, N - 1) == ba(x, N - 1, N - 1) && fa[x](0, 0) == ba(x, 0, 0);
+
+    cout << setw(8) << type_name << setw(3) << N << "x" << left << setw(3) << N << right << fixed << setprecision(2)
+         << "  mul: object " << setw(8) << count / mul_obj / 1e6 << "  fixed " << setw(8) << count / mul_fixed / 1e6
+         << "  batch " << setw(8) << count / mul_batch / 1e6 << " M/s (x" << mul_obj / mul_batch << ")"
+         << "  add: object " << setw(8) << count / add_obj / 1e6 << "  fixed " << setw(8) << count / add_fixed / 1e6
+         << "  batch " << setw(8) << count / add_batch / 1e6 << " M/s (x" << add_obj / add_batch << ")"
+         << "  " << (ok ? "ok" : "MISMATCH") << endl;
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    ThreadPool::global().set_threads(argc > 2 ? atoi(argv[2]) : 1);
+    cout << "count = " << count << ", threads = " << ThreadPool::global().threads()
+         << ", isa = " << simd::isa_name(simd::best_isa()) << endl;
+    bool ok = bench<float, 4>("float", count) & bench<float, 8>("float", count)
+            & bench<double, 4>("double", count) & bench<double, 8>("double", count);
+    return ok ? 0 : 1;
+}
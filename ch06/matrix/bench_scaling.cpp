@@ -0,0 +1,63 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include "parallel.h"
+using namespace std;
+
+// 强扩展测试：固定问题规模，线程数从1增加到N，统计乘法与加法的耗时、加速比和并行效率。
+// 同时检查整数乘法在每个线程数下都与单线程结果逐位相同。
+// 用法：bench_scaling [n=2048] [max_threads=硬件线程数]
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 2048;
+    int max_threads = argc > 2 ? atoi(argv[2]) : int(thread::hardware_concurrency());
+    if (max_threads < 1) max_threads = 1;
+
+    vector<double> a(size_t(n) * n), b(size_t(n) * n), c(size_t(n) * n);
+    vector<int> ia(size_t(n) * n), ib(size_t(n) * n), ic(size_t(n) * n), ref(size_t(n) * n);
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = double(i % 17) / 16;
+        b[i] = double(i % 13) / 12;
+        ia[i] = int(i % 17) - 8;
+        ib[i] = int(i % 13) - 6;
+    }
+
+    ThreadPool &pool = ThreadPool::global();
+    double t_mul1 = 0, t_add1 = 0;
+    cout << "n = " << n << endl;
+    cout << "threads    mul(s)   GFLOPS  speedup  eff    add(s)  speedup  int-exact" << endl;
+    // 线程数取小于max_threads的2的幂，最后再测一次max_threads本身
+    vector<int> threads;
+    for (int t = 1; t < max_threads; t *= 2) threads.push_back(t);
+    threads.push_back(max_threads);
+    for (int t : threads) {
+        pool.set_threads(t);
+        double t_mul = seconds([&] {
+            par_gemm(n, n, n, 1.0, a.data(), n, 1, b.data(), n, 1, 0.0, c.data(), n, 1);
+        });
+        double t_add = seconds([&] {
+            for (int r = 0; r < 10; r++) par_add(n, n, c.data(), n, a.data(), n);
+        });
+        par_gemm(n, n, n, 1, ia.data(), n, 1, ib.data(), n, 1, 0, ic.data(), n, 1);
+        if (t == 1) {
+            t_mul1 = t_mul;
+            t_add1 = t_add;
+            ref = ic;
+        }
+        cout << setw(7) << t << fixed << setprecision(3)
+             << setw(10) << t_mul << setw(9) << setprecision(1) << 2.0 * n * n * n / t_mul / 1e9
+             << setw(9) << setprecision(2) << t_mul1 / t_mul << setw(6) << t_mul1 / t_mul / t
+             << setw(10) << setprecision(3) << t_add << setw(9) << setprecision(2) << t_add1 / t_add
+             << setw(11) << (ic == ref ? "yes" : "NO") << endl;
+    }
+}
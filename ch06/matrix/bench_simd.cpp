@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include "simd.h"
+#include "gemm.h"
+using namespace std;
+
+// 对比每一种指令集的内核与标量内核的速度，并与乘加单元的峰值比较（微内核和单线程gemm各占峰值的百分之几）。
+// 设置MATRIX_CALIBRATE=1可让微内核改为按实测速度选择（见simd.h）
+// 编译：g++ -std=c++17 -O2 bench_simd.cpp -o bench_simd（不需要-march，内核在运行时分派）
+
+template <typename Func>
+double seconds(Func f, int reps) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// 峰值：CH条互不依赖的乘加链x = x * y + z，只在寄存器里计算，衡量乘加单元每秒能完成多少次运算
+template <typename T, int Bytes>
+inline __attribute__((always_inline)) T peak_body(long n, T y, T z) {
+    typedef T V __attribute__((vector_size(Bytes)));
+    const int CH = 12;      // 乘加延迟约4个周期、每周期最多两条，12条链足以填满流水线
+    V x[CH];
+#pragma GCC unroll 16
+    for (int c = 0; c < CH; c++) x[c] = V{} + T(c);
+    V vy = V{} + y, vz = V{} + z;
+    for (long i = 0; i < n; i++)
+#pragma GCC unroll 16
+        for (int c = 0; c < CH; c++) x[c] = x[c] * vy + vz;
+    T sum = T();
+    for (int c = 0; c < CH; c++)
+        for (int l = 0; l < int(Bytes / sizeof(T)); l++) sum += x[c][l];
+    return sum;
+}
+
+#if SIMD_X86
+template <typename T> __attribute__((target("sse2")))
+T peak_sse2(long n, T y, T z) { return peak_body<T, 16>(n, y, z); }
+template <typename T> __attribute__((target("avx2,fma")))
+T peak_avx2(long n, T y, T z) { return peak_body<T, 32>(n, y, z); }
+template <typename T> __attribute__((target("avx512f")))
+T peak_avx512(long n, T y, T z) { return peak_body<T, 64>(n, y, z); }
+#endif
+
+// 指定指令集下每秒的运算次数（一次乘加算两次），单位G。标量内核会被编译器按基准指令集自动向量化，
+// 没有可比的峰值，返回0
+template <typename T>
+double peak(simd::Isa isa, T &sink) {
+    T (*f)(long, T, T) = 0;
+    int lanes = 1;
+#if SIMD_X86
+    if (isa == simd::SSE2) f = peak_sse2<T>, lanes = 16 / sizeof(T);
+    if (isa == simd::AVX2) f = peak_avx2<T>, lanes = 32 / sizeof(T);
+    if (isa == simd::AVX512) f = peak_avx512<T>, lanes = 64 / sizeof(T);
+#endif
+    if (!f) return 0;
+    const long n = 1 << 20;
+    double t = 0;
+    for (int r = 0; r < 3; r++) {
+        double d = seconds([&] { sink += f(n, T(1), T(0)); }, 1);
+        if (r == 0 || d < t) t = d;
+    }
+    return 2.0 * 12 * lanes * n / t / 1e9;
+}
+
+template <typename T>
+void bench(const char *type_name) {
+    const size_t n = 4096;          // 两个数组共32KB左右，留在L1/L2中
+    const int kc = 256, add_reps = 20000, micro_reps = 20000;
+    vector<T> x(n, T(1)), y(n, T(2));
+    T sink = T();
+
+    double add_base = 0, micro_base = 0, best_peak = 0;
+    for (int i = 0; i < simd::ISA_COUNT; i++) {
+        simd::Isa isa = simd::Isa(i);
+        if (!simd::supported(isa)) continue;
+        simd::Kernels<T> k = simd::kernels_for<T>(isa);
+        vector<T> a(size_t(kc) * k.mr, T(1)), b(size_t(kc) * k.nr, T(1)), c(size_t(k.mr) * k.nr);
+        double t_add = seconds([&] { k.add(x.data(), y.data(), n); }, add_reps);
+        double t_micro = seconds([&] {
+            k.micro(kc, a.data(), b.data(), c.data(), k.nr, 1, k.mr, k.nr, T(1), T(), true);
+        }, micro_reps);
+        double gops = 2.0 * kc * k.mr * k.nr * micro_reps / t_micro / 1e9, top = peak<T>(isa, sink);
+        if (isa == simd::SCALAR) {
+            add_base = t_add;
+            micro_base = gops;
+        }
+        if (isa == simd::micro_isa<T>()) best_peak = top;
+        double elems = double(n) * add_reps;
+        cout << setw(8) << type_name << setw(8) << simd::isa_name(isa)
+             << "  add: " << setw(8) << fixed << setprecision(2) << elems / t_add / 1e9 << " Gelem/s"
+             << " (x" << setprecision(2) << add_base / t_add << ")"
+             << "  micro " << k.mr << "x" << k.nr << ": " << setw(8) << gops << " Gop/s"
+             << " (x" << gops / micro_base;
+        if (top > 0) cout << ", " << setprecision(0) << 100 * gops / top << "% of peak " << setprecision(2) << top;
+        cout << ")" << endl;
+        if (c[0] == T(-1)) cout << "";
+    }
+
+    // 单线程gemm：n = 512的行主序方阵，按实际选用的微内核计算，与该指令集的峰值比较
+    const int m = 512, reps = 5;
+    vector<T> A(size_t(m) * m, T(1)), B(size_t(m) * m, T(1)), C(size_t(m) * m);
+    gemm(m, m, m, T(1), A.data(), m, 1, B.data(), m, 1, T(), C.data(), m, 1);      // 预热，也分配打包缓冲区
+    double t = seconds([&] { gemm(m, m, m, T(1), A.data(), m, 1, B.data(), m, 1, T(), C.data(), m, 1); }, reps);
+    double gops = 2.0 * m * m * m * reps / t / 1e9;
+    cout << setw(8) << type_name << "  micro kernel in use: " << simd::isa_name(simd::micro_isa<T>())
+         << "  gemm n=" << m << ": " << setprecision(2) << gops << " Gop/s";
+    if (best_peak > 0) cout << " (" << setprecision(0) << 100 * gops / best_peak << "% of peak)" << setprecision(2);
+    cout << endl;
+    if (C[0] != T(m)) cout << "gemm result is wrong: " << C[0] << endl;
+    // 防止编译器把结果整个优化掉
+    if (x[0] == T(-1) || sink == T(-1)) cout << "";
+}
+
+int main() {
+    cout << "best isa: " << simd::isa_name(simd::best_isa()) << endl;
+    bench<float>("float");
+    bench<double>("double");
+    bench<int>("int32");
+}
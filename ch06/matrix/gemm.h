@@ -0,0 +1,148 @@
+#ifndef CODING_GEMM_H
+#define CODING_GEMM_H
+
+#include <vector>
+#include <algorithm>
+#include "simd.h"
+
+// 分块矩阵乘法：C = alpha * A * B + beta * C
+// 按照Goto/BLIS的思路，把乘法拆成三层分块：
+//   NC列的B面板（L3） -> KC行的B面板打包（L1/L2共享） -> MC行的A块打包（L2）
+// 最内层是一个MR*NR的寄存器微内核，它只在连续打包好的数据上做流式访问，结果直接累加到C中。
+// 每个矩阵都以(行步长, 列步长)来描述，所以行主序、列主序（即转置）以及子矩阵都可以直接传进来。
+
+namespace gemm_detail {
+
+// 分块参数。KC*NR的B微面板放进L1；MC*KC的A块放进L2；NC列的B面板放进L3
+template <typename T>
+struct Block {
+    static const int KC = 256;
+    static const int MC = 128;
+    static const int NC = 2048;
+};
+template <> struct Block<float> {
+    static const int KC = 256, MC = 128, NC = 4096;
+};
+template <> struct Block<int> {
+    static const int KC = 256, MC = 128, NC = 4096;
+};
+
+// 微内核和它的寄存器块形状MR*NR（MR*NR个累加器放在寄存器里）。float、double和int用simd.h中
+// 按指令集分派的向量内核，形状随指令集而变；其它类型用4*8的标量内核。
+// MC、NC取整为MR、NR的倍数，这样par_gemm切出的每一块都与串行时的微块对齐
+template <typename T>
+struct Tiling {
+    simd::MicroFn<T> micro;
+    int MR, NR, KC, MC, NC;
+};
+
+template <typename T>
+Tiling<T> make_tiling(simd::MicroFn<T> micro, int mr, int nr) {
+    return {micro, mr, nr, Block<T>::KC, Block<T>::MC / mr * mr, Block<T>::NC / nr * nr};
+}
+
+template <typename T>
+Tiling<T> simd_tiling() {
+    const simd::Kernels<T> &k = simd::kernels<T>();
+    return make_tiling<T>(k.micro, k.mr, k.nr);
+}
+
+template <typename T>
+inline const Tiling<T>& tiling() {
+    static const Tiling<T> t = make_tiling<T>(simd::micro_scalar<T, 4, 8>, 4, 8);
+    return t;
+}
+template <> inline const Tiling<float>& tiling<float>() {
+    static const Tiling<float> t = simd_tiling<float>();
+    return t;
+}
+template <> inline const Tiling<double>& tiling<double>() {
+    static const Tiling<double> t = simd_tiling<double>();
+    return t;
+}
+template <> inline const Tiling<int>& tiling<int>() {
+    static const Tiling<int> t = simd_tiling<int>();
+    return t;
+}
+
+// 将A[0:mc, 0:kc]按MR行一组打包：每一组内按列连续存放，不足MR行的部分补0
+template <typename T>
+void pack_a(int mc, int kc, const T *A, long rs, long cs, T *buf, int MR) {
+    for (int i = 0; i < mc; i += MR) {
+        int mr = std::min(MR, mc - i);
+        for (int p = 0; p < kc; p++) {
+            const T *a = A + i * rs + p * cs;
+            for (int r = 0; r < mr; r++) *buf++ = a[r * rs];
+            for (int r = mr; r < MR; r++) *buf++ = T();
+        }
+    }
+}
+
+// 将B[0:kc, 0:nc]按NR列一组打包：每一组内按行连续存放，不足NR列的部分补0
+template <typename T>
+void pack_b(int kc, int nc, const T *B, long rs, long cs, T *buf, int NR) {
+    for (int j = 0; j < nc; j += NR) {
+        int nr = std::min(NR, nc - j);
+        for (int p = 0; p < kc; p++) {
+            const T *b = B + p * rs + j * cs;
+            for (int c = 0; c < nr; c++) *buf++ = b[c * cs];
+            for (int c = nr; c < NR; c++) *buf++ = T();
+        }
+    }
+}
+
+// 每个线程各自持有的打包缓冲区，只增长不释放，避免每次乘法都去分配
+template <typename T>
+std::vector<T>& pack_buffer(int which) {
+    thread_local std::vector<T> bufs[2];
+    return bufs[which];
+}
+
+} // namespace gemm_detail
+
+template <typename T>
+void gemm(int m, int n, int k, T alpha,
+          const T *A, long rsa, long csa,
+          const T *B, long rsb, long csb,
+          T beta, T *C, long rsc, long csc) {
+    using namespace gemm_detail;
+    const Tiling<T> &t = tiling<T>();
+    const int MR = t.MR, NR = t.NR, KC = t.KC, MC = t.MC, NC = t.NC;
+    if (m <= 0 || n <= 0) return;
+    if (k <= 0) {
+        // 没有乘积项，只剩下beta * C
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++) {
+                T &c = C[i * rsc + j * csc];
+                c = beta == T() ? T() : beta * c;
+            }
+        return;
+    }
+
+    std::vector<T> &a_buf = pack_buffer<T>(0), &b_buf = pack_buffer<T>(1);
+    size_t a_need = size_t(MC) * KC, b_need = size_t(KC) * (std::min(n, NC) + NR);
+    if (a_buf.size() < a_need) a_buf.resize(a_need);
+    if (b_buf.size() < b_need) b_buf.resize(b_need);
+
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            pack_b(kc, nc, B + pc * rsb + jc * csb, rsb, csb, b_buf.data(), NR);
+            for (int ic = 0; ic < m; ic += MC) {
+                int mc = std::min(MC, m - ic);
+                pack_a(mc, kc, A + ic * rsa + pc * csa, rsa, csa, a_buf.data(), MR);
+                for (int jr = 0; jr < nc; jr += NR) {
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        t.micro(kc, a_buf.data() + ir * kc, b_buf.data() + jr * kc,
+                                C + (ic + ir) * rsc + (jc + jr) * csc, rsc, csc,
+                                std::min(MR, mc - ir), std::min(NR, nc - jr),
+                                alpha, beta, pc == 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif //CODING_GEMM_H
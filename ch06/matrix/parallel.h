@@ -0,0 +1,80 @@
+#ifndef CODING_PARALLEL_H
+#define CODING_PARALLEL_H
+
+#include <algorithm>
+#include "gemm.h"
+#include "simd.h"
+#include "ThreadPool.h"
+
+// 多线程版本的矩阵乘法与加法：把输出C切成若干互不重叠的块，每块作为一个任务交给全局线程池。
+// 每个块内部仍然调用串行的gemm/vec_add，且每个元素沿k方向的累加顺序与串行完全一样，
+// 因此结果与串行路径逐位相同（整数类型如此，浮点类型也如此）。微内核按best_isa()固定选择，
+// 所以同一台机器上不同次运行的结果也逐位相同；设置了MATRIX_CALIBRATE时只保证同一进程内如此（见simd.h）。
+// 计算量很小时直接走串行路径，省掉调度的开销。
+
+// 行主序矩阵C(m×n) = alpha * A(m×k) * B(k×n) + beta * C，步长含义同gemm()
+template <typename T>
+void par_gemm(int m, int n, int k, T alpha,
+              const T *A, long rsa, long csa,
+              const T *B, long rsb, long csb,
+              T beta, T *C, long rsc, long csc,
+              ThreadPool &pool = ThreadPool::global()) {
+    const gemm_detail::Tiling<T> &tl = gemm_detail::tiling<T>();
+    const int MR = tl.MR, NR = tl.NR;
+    int threads = pool.threads();
+    if (threads == 1 || double(m) * n * k < 64.0 * 64 * 64) {
+        gemm(m, n, k, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc);
+        return;
+    }
+    // 从(MC, NC)大小的块开始，块数不够每个线程分到4块时先切列，再切行
+    int tr = tl.MC, tc = tl.NC;
+    auto tiles = [&] { return ((m + tr - 1) / tr) * ((n + tc - 1) / tc); };
+    while (tiles() < 4 * threads && tc > 4 * NR) tc = (tc / 2 + NR - 1) / NR * NR;
+    while (tiles() < 4 * threads && tr > 2 * MR) tr = (tr / 2 + MR - 1) / MR * MR;
+    int row_tiles = (m + tr - 1) / tr, col_tiles = (n + tc - 1) / tc;
+    pool.parallel_for(row_tiles * col_tiles, [&](int t) {
+        int i = t / col_tiles * tr, j = t % col_tiles * tc;
+        gemm(std::min(tr, m - i), std::min(tc, n - j), k, alpha,
+             A + i * rsa, rsa, csa, B + j * csb, rsb, csb,
+             beta, C + i * rsc + j * csc, rsc, csc);
+    });
+}
+
+// 把[0, n)切成每段至少grain个元素的若干段，对每一段调用f(begin, end)
+template <typename Func>
+void par_range(long n, Func f, long grain = 1 << 16, ThreadPool &pool = ThreadPool::global()) {
+    if (n <= 0) return;
+    int tasks = int(std::min<long>(pool.threads() * 4L, (n + grain - 1) / grain));
+    if (tasks <= 1) {
+        f(0L, n);
+        return;
+    }
+    long per = (n + tasks - 1) / tasks;
+    pool.parallel_for(tasks, [&](int t) { f(t * per, std::min(n, (t + 1) * per)); });
+}
+
+// dst(rows×cols) += src，两者都是行主序，行步长分别为ld_dst和ld_src
+template <typename T>
+void par_add(int rows, int cols, T *dst, long ld_dst, const T *src, long ld_src,
+             ThreadPool &pool = ThreadPool::global()) {
+    if (rows <= 0 || cols <= 0) return;
+    const long grain = 1 << 16;     // 每个任务至少处理这么多个元素
+    long total = long(rows) * cols;
+    int tasks = int(std::min<long>(pool.threads() * 4L, (total + grain - 1) / grain));
+    tasks = std::max(1, std::min(tasks, rows));
+    int per = (rows + tasks - 1) / tasks;
+    tasks = (rows + per - 1) / per;
+    auto run = [&](int t) {
+        int end = std::min(rows, (t + 1) * per);
+        if (ld_dst == cols && ld_src == cols) {
+            // 连续存储时整段交给SIMD内核
+            vec_add(dst + long(t) * per * cols, src + long(t) * per * cols, size_t(end - t * per) * cols);
+        } else {
+            for (int i = t * per; i < end; i++) vec_add(dst + i * ld_dst, src + i * ld_src, size_t(cols));
+        }
+    };
+    if (tasks == 1) run(0);
+    else pool.parallel_for(tasks, run);
+}
+
+#endif //CODING_PARALLEL_H
@@ -0,0 +1,352 @@
+#ifndef CODING_SIMD_H
+#define CODING_SIMD_H
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+// 运行时分派的SIMD内核。
+// 同一份内核代码用GCC/Clang的向量扩展写成，再用target属性分别编译成SSE2、AVX2和AVX-512版本；
+// 程序第一次用到时通过CPUID检测一次CPU支持的指令集，选出最宽的那一套函数指针，之后不再检测。
+// 这样同一个二进制文件在不同的机器上都能跑满向量宽度。
+// 乘法微内核同样按best_isa()选择，所以同一台机器上每次运行选中的内核、算出的浮点结果都相同。
+// 设置环境变量MATRIX_CALIBRATE=1时改为第一次用到时试跑本机支持的各个版本，只有明显（至少快20%）
+// 胜过best_isa()的版本才会取而代之（见micro_isa）；这样选出的内核可能因运行而异，
+// 不同内核的向量宽度和乘加融合不同，浮点结果也就可能在最后几位上不同。
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+namespace simd {
+
+enum Isa { SCALAR, SSE2, AVX2, AVX512, ISA_COUNT };
+
+inline const char* isa_name(Isa isa) {
+    static const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+    return names[isa];
+}
+
+const int LINE = 64;
+
+// 乘法微内核：C[0:m, 0:n] = alpha * sum_p a[p][0:MR]^T * b[p][0:NR] + beta * C。
+// a、b是gemm.h按MR行、NR列打包好的面板，m <= MR，n <= NR，C的行步长为rs、列步长为cs；
+// first为false时C不缩放、直接累加（同一块C的第二个及以后的KC面板）。各指令集的MR、NR不同，见Kernels
+template <typename T>
+using MicroFn = void (*)(int kc, const T *a, const T *b, T *C, long rs, long cs,
+                         int m, int n, T alpha, T beta, bool first);
+
+// ===== 标量版本 =====
+template <typename T>
+void add_scalar(T *dst, const T *src, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+// 把行主序的乘积和acc[MR][NR]写回C的m*n的角落。first为true时C按beta缩放（beta为0时不读取C），否则直接累加
+template <typename T>
+void store_tile(const T *acc, int NR, T *C, long rs, long cs, int m, int n, T alpha, T beta, bool first) {
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            T &c = C[i * rs + j * cs];
+            T v = alpha == T(1) ? acc[i * NR + j] : alpha * acc[i * NR + j];
+            if (!first || beta == T(1)) c += v;
+            else if (beta == T()) c = v;
+            else c = beta * c + v;
+        }
+    }
+}
+
+// 标量微内核，参数含义见MicroFn。没有向量版本的元素类型也用它（gemm.h中取4*8）
+template <typename T, int MR = 4, int NR = int(LINE / sizeof(T))>
+void micro_scalar(int kc, const T *a, const T *b, T *C, long rs, long cs,
+                  int m, int n, T alpha, T beta, bool first) {
+    T c[MR][NR] = {};
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < MR; i++)
+            for (int j = 0; j < NR; j++) c[i][j] += a[i] * b[j];
+        a += MR;
+        b += NR;
+    }
+    store_tile(&c[0][0], NR, C, rs, cs, m, n, alpha, beta, first);
+}
+
+// 批量小矩阵乘法中每组交错存放的矩阵个数
+template <typename T>
+constexpr int batch_lanes() { return sizeof(T) < LINE ? int(LINE / sizeof(T)) : 1; }
+
+// 批量小矩阵乘法：L = batch_lanes<T>()个m*k的矩阵与同样多个k*n的矩阵交错存放，
+// 元素(i, j)的L个副本占连续的一个缓存行，即a[(i * k + p) * L + l]是第l个矩阵的A(i, p)。
+// c[(i * n + j) * L + l] = sum_p a[(i * k + p) * L + l] * b[(p * n + j) * L + l]
+template <typename T>
+void batch_scalar(int m, int n, int k, const T *a, const T *b, T *c) {
+    const int L = batch_lanes<T>();
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++) {
+            T acc[L] = {};
+            for (int p = 0; p < k; p++)
+                for (int l = 0; l < L; l++) acc[l] += a[(i * k + p) * L + l] * b[(p * n + j) * L + l];
+            memcpy(c + (i * n + j) * L, acc, sizeof acc);
+        }
+}
+
+#if SIMD_X86
+// ===== 向量版本：Bytes为向量寄存器的宽度 =====
+// 各指令集微内核的形状MR行 * NV个向量：MR * NV个累加器，加上NV个B向量和一个广播值，不超过向量寄存器的个数
+const int SSE2_MR = 6, SSE2_NV = 2;         // 16个xmm：12 + 2 + 1
+const int AVX2_MR = 6, AVX2_NV = 2;         // 16个ymm：12 + 2 + 1
+const int AVX512_MR = 14, AVX512_NV = 2;    // 32个zmm：28 + 2 + 1
+
+// always_inline保证它们被内联到带target属性的外壳函数里，从而按外壳的指令集生成代码
+template <typename T, int Bytes>
+inline __attribute__((always_inline)) void add_body(T *dst, const T *src, size_t n) {
+    typedef T V __attribute__((vector_size(Bytes)));
+    const size_t W = Bytes / sizeof(T);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V x, y;
+        memcpy(&x, dst + i, Bytes);
+        memcpy(&y, src + i, Bytes);
+        x += y;
+        memcpy(dst + i, &x, Bytes);
+    }
+    for (; i < n; i++) dst[i] += src[i];
+}
+
+// MR行 * NV个向量的累加器整个放在寄存器里：每一步k载入NV个B向量、广播MR个A元素，做MR * NV次乘加，
+// 这些乘加互不依赖，足以填满乘加单元的流水线。循环必须完全展开，累加器才不会落到栈上。
+// 整块且C的行连续（cs == 1）时累加器直接与C合并写回；边角块先存到局部数组，再逐个写回
+template <typename T, int Bytes, int MR, int NV>
+inline __attribute__((always_inline)) void micro_body(int kc, const T *a, const T *b, T *C, long rs, long cs,
+                                                      int m, int n, T alpha, T beta, bool first) {
+    typedef T V __attribute__((vector_size(Bytes)));
+    const int W = Bytes / sizeof(T), NR = NV * W;
+    V c[MR][NV];
+#pragma GCC unroll 16
+    for (int i = 0; i < MR; i++)
+#pragma GCC unroll 4
+        for (int v = 0; v < NV; v++) c[i][v] = V{};
+    for (int p = 0; p < kc; p++) {
+        V bv[NV];
+#pragma GCC unroll 4
+        for (int v = 0; v < NV; v++) memcpy(&bv[v], b + v * W, Bytes);
+#pragma GCC unroll 16
+        for (int i = 0; i < MR; i++) {
+            V ai = a[i] - V{};      // 广播。减去零向量不改变任何值，编译器会省掉；加零则不能（-0 + 0 = +0）
+#pragma GCC unroll 4
+            for (int v = 0; v < NV; v++) c[i][v] += ai * bv[v];
+        }
+        a += MR;
+        b += NR;
+    }
+    if (m == MR && n == NR && cs == 1) {
+#pragma GCC unroll 16
+        for (int i = 0; i < MR; i++)
+#pragma GCC unroll 4
+            for (int v = 0; v < NV; v++) {
+                T *cp = C + i * rs + v * W;
+                V x = alpha == T(1) ? c[i][v] : alpha * c[i][v], y;
+                if (!first || beta == T(1)) {
+                    memcpy(&y, cp, Bytes);
+                    x += y;
+                } else if (beta != T()) {
+                    memcpy(&y, cp, Bytes);
+                    x = beta * y + x;
+                }
+                memcpy(cp, &x, Bytes);
+            }
+        return;
+    }
+    T acc[MR][NR];
+    memcpy(acc, c, sizeof acc);
+    store_tile(&acc[0][0], NR, C, rs, cs, m, n, alpha, beta, first);
+}
+
+// 沿批量方向向量化：每个结果元素的L个副本放在寄存器里累加
+template <typename T, int Bytes>
+inline __attribute__((always_inline)) void batch_body(int m, int n, int k, const T *a, const T *b, T *c) {
+    typedef T V __attribute__((vector_size(Bytes)));
+    const int L = LINE / sizeof(T), NV = LINE / Bytes, W = Bytes / sizeof(T);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++) {
+            V acc[NV];
+            for (int v = 0; v < NV; v++) acc[v] = V{};
+            for (int p = 0; p < k; p++) {
+                const T *ap = a + (i * k + p) * L, *bp = b + (p * n + j) * L;
+                for (int v = 0; v < NV; v++) {
+                    V x, y;
+                    memcpy(&x, ap + v * W, Bytes);
+                    memcpy(&y, bp + v * W, Bytes);
+                    acc[v] += x * y;
+                }
+            }
+            memcpy(c + (i * n + j) * L, acc, sizeof acc);
+        }
+}
+
+template <typename T> __attribute__((target("sse2")))
+void add_sse2(T *dst, const T *src, size_t n) { add_body<T, 16>(dst, src, n); }
+template <typename T> __attribute__((target("avx2")))
+void add_avx2(T *dst, const T *src, size_t n) { add_body<T, 32>(dst, src, n); }
+template <typename T> __attribute__((target("avx512f")))
+void add_avx512(T *dst, const T *src, size_t n) { add_body<T, 64>(dst, src, n); }
+
+template <typename T> __attribute__((target("sse2")))
+void micro_sse2(int kc, const T *a, const T *b, T *C, long rs, long cs, int m, int n, T alpha, T beta, bool first) {
+    micro_body<T, 16, SSE2_MR, SSE2_NV>(kc, a, b, C, rs, cs, m, n, alpha, beta, first);
+}
+template <typename T> __attribute__((target("avx2,fma")))
+void micro_avx2(int kc, const T *a, const T *b, T *C, long rs, long cs, int m, int n, T alpha, T beta, bool first) {
+    micro_body<T, 32, AVX2_MR, AVX2_NV>(kc, a, b, C, rs, cs, m, n, alpha, beta, first);
+}
+template <typename T> __attribute__((target("avx512f")))
+void micro_avx512(int kc, const T *a, const T *b, T *C, long rs, long cs, int m, int n, T alpha, T beta, bool first) {
+    micro_body<T, 64, AVX512_MR, AVX512_NV>(kc, a, b, C, rs, cs, m, n, alpha, beta, first);
+}
+
+template <typename T> __attribute__((target("sse2")))
+void batch_sse2(int m, int n, int k, const T *a, const T *b, T *c) { batch_body<T, 16>(m, n, k, a, b, c); }
+template <typename T> __attribute__((target("avx2,fma")))
+void batch_avx2(int m, int n, int k, const T *a, const T *b, T *c) { batch_body<T, 32>(m, n, k, a, b, c); }
+template <typename T> __attribute__((target("avx512f")))
+void batch_avx512(int m, int n, int k, const T *a, const T *b, T *c) { batch_body<T, 64>(m, n, k, a, b, c); }
+#endif
+
+// ===== 分派 =====
+inline bool supported(Isa isa) {
+#if SIMD_X86
+    __builtin_cpu_init();
+    switch (isa) {
+        case SCALAR: return true;
+        case SSE2: return __builtin_cpu_supports("sse2");
+        case AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case AVX512: return __builtin_cpu_supports("avx512f");
+        default: return false;
+    }
+#else
+    return isa == SCALAR;
+#endif
+}
+
+// 本机支持的最宽指令集，只检测一次
+inline Isa best_isa() {
+    static const Isa isa = supported(AVX512) ? AVX512
+                         : supported(AVX2) ? AVX2
+                         : supported(SSE2) ? SSE2 : SCALAR;
+    return isa;
+}
+
+// 只为float、double和int（int32）提供向量版本
+template <typename T>
+struct Kernels {
+    void (*add)(T *, const T *, size_t);
+    MicroFn<T> micro;
+    int mr, nr;             // micro的寄存器块形状，gemm.h按它打包
+    void (*batch)(int, int, int, const T *, const T *, T *);
+};
+
+// 返回指定指令集的内核；调用者需先用supported()确认本机可以执行
+template <typename T>
+Kernels<T> kernels_for(Isa isa) {
+    Kernels<T> k = {add_scalar<T>, micro_scalar<T>, 4, int(LINE / sizeof(T)), batch_scalar<T>};
+#if SIMD_X86
+    switch (isa) {
+        case SSE2:
+            k.add = add_sse2<T>; k.batch = batch_sse2<T>;
+            k.micro = micro_sse2<T>; k.mr = SSE2_MR; k.nr = SSE2_NV * int(16 / sizeof(T));
+            break;
+        case AVX2:
+            k.add = add_avx2<T>; k.batch = batch_avx2<T>;
+            k.micro = micro_avx2<T>; k.mr = AVX2_MR; k.nr = AVX2_NV * int(32 / sizeof(T));
+            break;
+        case AVX512:
+            k.add = add_avx512<T>; k.batch = batch_avx512<T>;
+            k.micro = micro_avx512<T>; k.mr = AVX512_MR; k.nr = AVX512_NV * int(64 / sizeof(T));
+            break;
+        default: break;
+    }
+#endif
+    return k;
+}
+
+// 乘法微内核使用的指令集。默认就是best_isa()；设置了MATRIX_CALIBRATE=1时，每个版本在一个典型大小的面板上
+// 跑几轮、取最好的一轮，每秒的乘加次数比best_isa()的版本多20%以上的才会被选中（计时有噪声，小的差距不足为凭）。
+// 总共约一毫秒，每种元素类型只做一次，之后都返回同一个结果
+template <typename T>
+Isa calibrate_micro() {
+    const int kc = 256, rounds = 5, reps = 32;
+    auto rate = [&](Isa isa) {
+        Kernels<T> k = kernels_for<T>(isa);
+        std::vector<T> a(size_t(kc) * k.mr, T(1)), b(size_t(kc) * k.nr, T(1)), c(size_t(k.mr) * k.nr);
+        auto run = [&] { k.micro(kc, a.data(), b.data(), c.data(), k.nr, 1, k.mr, k.nr, T(1), T(), true); };
+        run();      // 预热
+        double t = 0;
+        for (int r = 0; r < rounds; r++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < reps; i++) run();
+            double d = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (r == 0 || d < t) t = d;
+        }
+        return double(kc) * k.mr * k.nr * reps / t;
+    };
+    Isa best = best_isa();
+    double base = rate(best), best_rate = base;
+    for (int i = 0; i < ISA_COUNT; i++) {
+        Isa isa = Isa(i);
+        if (isa == best_isa() || !supported(isa)) continue;
+        double x = rate(isa);
+        if (x > 1.2 * base && x > best_rate) {
+            best = isa;
+            best_rate = x;
+        }
+    }
+    return best;
+}
+
+template <typename T>
+Isa micro_isa() {
+    static const Isa isa = [] {
+        const char *env = std::getenv("MATRIX_CALIBRATE");
+        return env && std::atoi(env) != 0 ? calibrate_micro<T>() : best_isa();
+    }();
+    return isa;
+}
+
+template <typename T>
+const Kernels<T>& kernels() {
+    static const Kernels<T> k = [] {
+        Kernels<T> k = kernels_for<T>(best_isa()), m = kernels_for<T>(micro_isa<T>());
+        k.micro = m.micro;
+        k.mr = m.mr;
+        k.nr = m.nr;
+        return k;
+    }();
+    return k;
+}
+
+} // namespace simd
+
+// 逐元素相加dst += src。其它元素类型走普通循环
+template <typename T>
+inline void vec_add(T *dst, const T *src, size_t n) { simd::add_scalar(dst, src, n); }
+inline void vec_add(float *dst, const float *src, size_t n) { simd::kernels<float>().add(dst, src, n); }
+inline void vec_add(double *dst, const double *src, size_t n) { simd::kernels<double>().add(dst, src, n); }
+inline void vec_add(int *dst, const int *src, size_t n) { simd::kernels<int>().add(dst, src, n); }
+
+// 一组batch_lanes<T>()个交错存放的小矩阵相乘，格式见simd::batch_scalar
+template <typename T>
+inline void vec_batch_mul(int m, int n, int k, const T *a, const T *b, T *c) { simd::batch_scalar(m, n, k, a, b, c); }
+inline void vec_batch_mul(int m, int n, int k, const float *a, const float *b, float *c) {
+    simd::kernels<float>().batch(m, n, k, a, b, c);
+}
+inline void vec_batch_mul(int m, int n, int k, const double *a, const double *b, double *c) {
+    simd::kernels<double>().batch(m, n, k, a, b, c);
+}
+inline void vec_batch_mul(int m, int n, int k, const int *a, const int *b, int *c) {
+    simd::kernels<int>().batch(m, n, k, a, b, c);
+}
+
+#endif //CODING_SIMD_H
@@ -0,0 +1,29 @@
+#ifndef CODING_TRANSPOSE_H
+#define CODING_TRANSPOSE_H
+
+// 缓存无关（cache-oblivious）的跨步拷贝：dst(i, j) = src(i, j)，两边都以(行步长, 列步长)描述。
+// 当两边的步长方向不同（典型的就是把转置视图物化成行主序矩阵）时，直接两重循环总有一边是跨行访问；
+// 这里把较长的一维不断对半切分，直到子块足够小、两边都能留在L1里再拷贝，
+// 因此不需要知道缓存的大小，在每一级缓存上都接近最优。
+
+const int COPY_LEAF = 16;       // 叶子块的边长上限
+
+template <typename T>
+void copy_strided(int rows, int cols, const T *src, long srs, long scs, T *dst, long drs, long dcs) {
+    if (rows <= COPY_LEAF && cols <= COPY_LEAF) {
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++) dst[i * drs + j * dcs] = src[i * srs + j * scs];
+        return;
+    }
+    if (rows >= cols) {
+        int half = rows / 2;
+        copy_strided(half, cols, src, srs, scs, dst, drs, dcs);
+        copy_strided(rows - half, cols, src + half * srs, srs, scs, dst + half * drs, drs, dcs);
+    } else {
+        int half = cols / 2;
+        copy_strided(rows, half, src, srs, scs, dst, drs, dcs);
+        copy_strided(rows, cols - half, src + half * scs, srs, scs, dst + half * dcs, drs, dcs);
+    }
+}
+
+#endif //CODING_TRANSPOSE_H
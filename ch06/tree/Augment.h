@@ -0,0 +1,34 @@
+#ifndef CODING_AUGMENT_H
+#define CODING_AUGMENT_H
+
+#include <cstddef>
+
+// 节点的扩充信息，作为BinaryTree的第五个模版参数。节点继承Augment::Data，用来存放额外的字段；
+// BinaryTreeNode::update()在重新计算高度之后调用Augment::update(node)，
+// 插入、删除、旋转和批量构建都经过它，所以扩充信息总是和子树一起保持正确。
+
+// 不扩充（默认）：Data是空类，节点不占额外的空间
+struct NoAugment {
+    static const bool enabled = false;
+    struct Data {};
+    template <typename Node>
+    static void update(Node *) {}
+};
+
+// 子树规模：_weight是子树中所有节点的_cnt之和，即把重复插入也算上的元素个数。
+// 借助它，BinaryTree的rank、select和count_range只需从根走到叶，都是O(树高)
+struct OrderStatistic {
+    static const bool enabled = true;
+    struct Data {
+        size_t _weight;
+    };
+    template <typename Node>
+    static size_t weight(const Node *node) { return node ? node->_weight : 0; }
+    // 子节点的_weight已经正确时，重新计算node的
+    template <typename Node>
+    static void update(Node *node) {
+        node->_weight = weight(node->l_child()) + weight(node->r_child()) + node->count();
+    }
+};
+
+#endif //CODING_AUGMENT_H
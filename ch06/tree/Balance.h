@@ -0,0 +1,39 @@
+#ifndef CODING_BALANCE_H
+#define CODING_BALANCE_H
+
+// 二叉树的平衡策略，作为BinaryTree的模版参数（把模版参数当作一种设计策略，见ch06/readme.md）。
+// 插入或删除之后，BinaryTree从发生变化的最低节点开始逐层向上，对路径上的每个节点调用
+// Balance::rebalance(node)：它负责更新node的高度，必要时做旋转，并返回这棵子树新的根。
+
+// 不做平衡：普通的二叉搜索树，有序输入会退化成链表
+struct NoBalance {
+    template <typename Node>
+    static Node* rebalance(Node *node) {
+        Node::update(node);
+        return node;
+    }
+};
+
+// AVL树：任意节点左右子树的高度差不超过1，因此无论以什么顺序插入、删除，
+// 树高都不超过1.44 * log2(n + 2)。每次插入或删除最多做O(log n)次旋转。
+struct AvlBalance {
+    template <typename Node>
+    static Node* rebalance(Node *node) {
+        Node::update(node);
+        int diff = Node::height(node->l_child()) - Node::height(node->r_child());
+        if (diff > 1) {
+            Node *l = node->l_child();
+            // 左子树偏右时先把它转成偏左（LR型化为LL型）
+            if (Node::height(l->l_child()) < Node::height(l->r_child())) Node::rotate_left(l);
+            return Node::rotate_right(node);
+        }
+        if (diff < -1) {
+            Node *r = node->r_child();
+            if (Node::height(r->r_child()) < Node::height(r->l_child())) Node::rotate_right(r);
+            return Node::rotate_left(node);
+        }
+        return node;
+    }
+};
+
+#endif //CODING_BALANCE_H
@@ -5,65 +5,310 @@
 #include "BinaryTree.h"
 #include "BinaryTreeNode.h"
 
-template <typename valType> class BinaryTreeNode;
-template <typename elemType>
-void BinaryTree<elemType>::insert(const elemType &elem) {
+// 插入与删除都是迭代的：先自顶向下找到位置，再沿父指针自底向上交给平衡策略调整，
+// 因此即使不做平衡、树退化成链表，也不会因为递归过深而栈溢出。
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::insert(const elemType &elem) {
     if (!_root) {
-        _root = new BinaryTreeNode<elemType>(elem);
-    } else {
-        _root->insert_value(elem);
+        _root = _alloc.create(elem);
+        _size = 1;
+        return;
+    }
+    Node *node = _root;
+    for (;;) {
+        if (_comp(elem, node->_val)) {
+            if (!node->_l_child) {
+                node->_l_child = _alloc.create(elem, node);
+                break;
+            }
+            node = node->_l_child;
+        } else if (_comp(node->_val, elem)) {
+            if (!node->_r_child) {
+                node->_r_child = _alloc.create(elem, node);
+                break;
+            }
+            node = node->_r_child;
+        } else {
+            // 已经在树中，只增加计数（以及路径上各节点的扩充信息）
+            node->_cnt++;
+            if (Augment::enabled) for (; node; node = node->_parent) Augment::update(node);
+            return;
+        }
+    }
+    _size++;
+    rebalance_from(node);
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::remove(const elemType &elem) {
+    if (Node *node = find_node(elem)) remove_node(node);
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+template <typename K>
+BinaryTreeNode<elemType, Augment>* BinaryTree<elemType, Balance, Alloc, Compare, Augment>::find_node(const K &key) const {
+    Node *node = _root;
+    while (node) {
+        if (_comp(key, node->_val)) node = node->_l_child;
+        else if (_comp(node->_val, key)) node = node->_r_child;
+        else return node;
+    }
+    return nullptr;
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+template <typename K>
+BinaryTreeNode<elemType, Augment>* BinaryTree<elemType, Balance, Alloc, Compare, Augment>::bound_node(const K &key, bool upper) const {
+    Node *node = _root, *bound = nullptr;
+    while (node) {
+        // node满足条件时记下它，再到左子树中找更小的；否则到右子树中找
+        if (upper ? _comp(key, node->_val) : !_comp(node->_val, key)) {
+            bound = node;
+            node = node->_l_child;
+        } else {
+            node = node->_r_child;
+        }
+    }
+    return bound;
+}
+
+// 从根往下走，每向右走一步，就把左子树和当前节点计入
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+template <typename K>
+size_t BinaryTree<elemType, Balance, Alloc, Compare, Augment>::rank_of(const K &key) const {
+    static_assert(Augment::enabled, "rank() and count_range() require Augment = OrderStatistic");
+    size_t rank = 0;
+    Node *node = _root;
+    while (node) {
+        if (_comp(node->_val, key)) {
+            rank += Augment::weight(node->_l_child) + node->_cnt;
+            node = node->_r_child;
+        } else {
+            node = node->_l_child;
+        }
+    }
+    return rank;
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+typename BinaryTree<elemType, Balance, Alloc, Compare, Augment>::iterator
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>::select(size_t k) const {
+    static_assert(Augment::enabled, "select() requires Augment = OrderStatistic");
+    Node *node = _root;
+    while (node) {
+        size_t left = Augment::weight(node->_l_child);
+        if (k < left) node = node->_l_child;
+        else if (k < left + node->_cnt) break;
+        else {
+            k -= left + node->_cnt;
+            node = node->_r_child;
+        }
     }
+    return make_iterator(node);
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::remove_root() {
+    if (_root) remove_node(_root);
 }
 
 // 移除一个节点之后必须保持二叉树的次序不变。
-// 算法：找到数值为elem的节点A，以该节点A的右子节点B取代自身，然后搬移A的左子节点C，
-// 使C成为右子节点B的左子树的叶节点。
-// 如果该节点A没有右子节点，则以左子节点C直接取代A本身即可。
-template <typename elemType>
-void BinaryTree<elemType>::remove(const elemType &elem) {
-    if (_root) {
-        if (_root->_val == elem) {
-            // 根节点的移除特别处理
-            remove_root();
+// 算法：如果节点A至多有一个子节点，直接以这个子节点取代A；
+// 否则以A的后继S（右子树中最左的节点）取代A：S先把自己的右子树交给它原来的父节点，再接管A的左右子树。
+// 这样树高不会增加（原来的做法把整棵左子树挂到右子树的最底部，每次删除都可能让树变高），
+// 之后再从结构发生变化的最低节点向上做平衡。
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::remove_node(Node *node) {
+    Node *lowest;
+    if (node->_l_child && node->_r_child) {
+        Node *succ = node->_r_child;
+        while (succ->_l_child) succ = succ->_l_child;
+        if (succ->_parent != node) {
+            lowest = succ->_parent;
+            replace(succ, succ->_r_child);
+            succ->_r_child = node->_r_child;
+            succ->_r_child->_parent = succ;
         } else {
-            // 移除非根节点
-            _root->remove_value(elem, _root);
+            lowest = succ;
         }
+        replace(node, succ);
+        succ->_l_child = node->_l_child;
+        succ->_l_child->_parent = succ;
+    } else {
+        lowest = node->_parent;
+        replace(node, node->_l_child ? node->_l_child : node->_r_child);
     }
+    _alloc.destroy(node);
+    _size--;
+    rebalance_from(lowest);
 }
 
-template <typename elemType>
-void BinaryTree<elemType>::remove_root() {
-    if (!_root) return;
-    BinaryTreeNode<elemType> *tmp = _root;
-    if (_root->_r_child) {
-        // 以右子节点取代根节点
-        _root = _root->_r_child;
-        // 将左子节点搬移到右子节点的左子树的底部
-        if (tmp->_l_child) {
-            BinaryTreeNode<elemType> *lc = tmp->_l_child;
-            BinaryTreeNode<elemType> *new_lc = _root->_l_child;
-            if (!new_lc) {
-                // 新的_root的左子树只有一个节点，直接将该节点接到右子节点的左子树上即可
-                _root->_r_child = lc;
-            } else {
-                // 新的_root的左子树的确是一棵树，遍历找到那个可接上的null节点，把lc接上去
-                BinaryTreeNode<elemType>::left_child_leaf(lc, new_lc);
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::replace(Node *u, Node *v) {
+    if (!u->_parent) _root = v;
+    else if (u->_parent->_l_child == u) u->_parent->_l_child = v;
+    else u->_parent->_r_child = v;
+    if (v) v->_parent = u->_parent;
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::rebalance_from(Node *node) {
+    while (node) {
+        node = Balance::rebalance(node);
+        if (!node->_parent) _root = node;
+        node = node->_parent;
+    }
+}
+
+// 逐个析构node为根的子树中的节点。沿父指针做后序遍历，不用递归
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::clear(Node *node) {
+    Node *stop = node->_parent;
+    while (node != stop) {
+        if (node->_l_child) node = node->_l_child;
+        else if (node->_r_child) node = node->_r_child;
+        else {
+            Node *parent = node->_parent;
+            if (parent != stop) {
+                if (parent->_l_child == node) parent->_l_child = nullptr;
+                else parent->_r_child = nullptr;
             }
+            _alloc.destroy(node);
+            node = parent;
         }
     }
-    else {
-        // 没有右子树，直接以左子节点取代根节点
-        _root = _root->_l_child;
+}
+
+// 批量构建分两遍：第一遍数出不同元素的个数n（顺便检查是否有序），第二遍按中序消费序列，
+// 先建左边的n / 2个，再建根，最后建右边的，每个节点只被访问一次；递归深度为log2(n)
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+template <typename Iterator>
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>::from_sorted(Iterator first, Iterator last, const Compare &comp) {
+    BinaryTree tree;
+    tree._comp = comp;
+    size_t n = first != last;
+    for (Iterator prev = first, it = first; it != last && ++it != last; prev = it) {
+        if (comp(*it, *prev)) {
+            cerr << "from_sorted: the range is not sorted" << endl;
+            exit(-1);
+        }
+        n += comp(*prev, *it);
     }
-    delete tmp;
+    auto next = [&]() {
+        auto val = &*first;
+        int cnt = count_of(first, 0);
+        for (++first; first != last && !comp(*val, *first); ++first) cnt += count_of(first, 0);
+        return make_pair(val, cnt);
+    };
+    tree._root = tree.build(n, next);
+    tree._size = n;
+    return tree;
+}
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+template <typename Next>
+BinaryTreeNode<elemType, Augment>* BinaryTree<elemType, Balance, Alloc, Compare, Augment>::build(size_t n, Next &next) {
+    if (n == 0) return nullptr;
+    Node *l = build(n / 2, next);
+    auto elem = next();
+    Node *node = _alloc.create(*elem.first);
+    node->_cnt = elem.second;
+    node->_l_child = l;
+    node->_r_child = build(n - n / 2 - 1, next);
+    if (node->_l_child) node->_l_child->_parent = node;
+    if (node->_r_child) node->_r_child->_parent = node;
+    Node::update(node);
+    return node;
 }
 
-template <typename elemType>
-void BinaryTree<elemType>::clear(BinaryTreeNode<elemType> *node) {
-    if (node) {
-        clear(node->_l_child);
-        clear(node->_r_child);
-        delete node;
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+template <typename Count>
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>::merge(const BinaryTree &a, const BinaryTree &b, Count cnt) {
+    const Compare &comp = a._comp;
+    vector<pair<const elemType *, int> > merged;
+    merged.reserve(a._size + b._size);
+    iterator i = a.begin(), j = b.begin();
+    while (i != a.end() || j != b.end()) {
+        int c;
+        const elemType *val;
+        if (j == b.end() || (i != a.end() && comp(*i, *j))) {
+            val = &*i;
+            c = cnt(i.count(), 0);
+            ++i;
+        } else if (i == a.end() || comp(*j, *i)) {
+            val = &*j;
+            c = cnt(0, j.count());
+            ++j;
+        } else {
+            val = &*i;
+            c = cnt(i.count(), j.count());
+            ++i;
+            ++j;
+        }
+        if (c > 0) merged.push_back(make_pair(val, c));
+    }
+    BinaryTree tree;
+    tree._comp = comp;
+    size_t k = 0;
+    auto next = [&]() { return merged[k++]; };
+    tree._root = tree.build(merged.size(), next);
+    tree._size = merged.size();
+    return tree;
+}
+
+// src和新树两边同步地沿父指针做前序遍历，每到一个节点就复制它尚未复制的子节点，不用递归
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+BinaryTreeNode<elemType, Augment>* BinaryTree<elemType, Balance, Alloc, Compare, Augment>::copy(const Node *src) {
+    if (!src) return nullptr;
+    const Node *stop = src->_parent;
+    Node *root = _alloc.create(src->_val), *tar = root;
+    tar->_cnt = src->_cnt;
+    while (src != stop) {
+        if (src->_l_child && !tar->_l_child) {
+            src = src->_l_child;
+            tar = tar->_l_child = _alloc.create(src->_val, tar);
+            tar->_cnt = src->_cnt;
+        } else if (src->_r_child && !tar->_r_child) {
+            src = src->_r_child;
+            tar = tar->_r_child = _alloc.create(src->_val, tar);
+            tar->_cnt = src->_cnt;
+        } else {
+            // 两个子树都已复制完，回到父节点之前算出高度与扩充信息
+            Node::update(tar);
+            src = src->_parent;
+            tar = tar->_parent;
+        }
     }
-}
\ No newline at end of file
+    return root;
+}
+
+// 按Eytzinger下标写出：中序遍历树，同时沿下标的中序依次填入每个节点的位置
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+void BinaryTree<elemType, Balance, Alloc, Compare, Augment>::save(const char *path) const {
+    vector<pair<const elemType *, int> > nodes(_size + 1);
+    size_t k = eytzinger::first(_size);
+    for (iterator it = begin(); it != end(); ++it, k = eytzinger::next(k, _size)) nodes[k] = make_pair(&*it, it.count());
+    treefile::write<elemType>(path, _size, [&](size_t i) { return nodes[i]; });
+}
+
+// 沿Eytzinger下标的中序读出的就是从小到大的序列，直接交给build()
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>
+BinaryTree<elemType, Balance, Alloc, Compare, Augment>::load(const char *path, const Compare &comp) {
+    treefile::Reader<elemType> in(path);
+    size_t n = in.n(), k = eytzinger::first(n);
+    elemType cur;
+    auto next = [&]() {
+        cur = in.value(k);
+        int cnt = in.count(k);
+        k = eytzinger::next(k, n);
+        return make_pair(&cur, cnt);
+    };
+    BinaryTree tree;
+    tree._comp = comp;
+    tree._root = tree.build(n, next);
+    tree._size = n;
+    return tree;
+}
@@ -8,70 +8,220 @@
 #include <iostream>
 using namespace std;
 
-template <typename valType> class BinaryTreeNode;
 #include "BinaryTreeNode.h"
+#include "Balance.h"
+#include "NodePool.h"
+#include "TreeIterator.h"
+#include "FrozenTree.h"
+#include "TreeFile.h"
+#include <type_traits>
+#include <functional>
+#include <vector>
+#include <utility>
+#include <cstdlib>
 
 // 模版类：二叉树
 // elemType指定了二叉树节点内存放的数值的数据类型
-template <typename elemType>
+// Balance是平衡策略（见Balance.h）：默认不做平衡；BinaryTree<elemType, AvlBalance>在任意插入、删除序列下
+// 都保持O(log n)的高度
+// Alloc是节点的分配策略（见NodePool.h）：默认从内存池中成块分配，BinaryTree<elemType, Balance, NewDelete>逐个new/delete
+// Compare是比较器，默认的less<>是透明的（is_transparent），查找时可以直接用能与elemType比较的其它类型
+// Augment是节点的扩充信息（见Augment.h）：默认没有；OrderStatistic在节点中维护子树规模，提供rank、select和count_range
+template <typename elemType, typename Balance = NoBalance, template <typename> class Alloc = NodePool,
+          typename Compare = less<>, typename Augment = NoAugment>
 class BinaryTree {
 public:
+    typedef BinaryTreeNode<elemType, Augment> Node;
+    typedef elemType value_type;
+    // 中序迭代器，从小到大
+    typedef TreeIterator<Node, InOrder<Node> > iterator;
+    typedef iterator const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef TreeIterator<Node, PreOrder<Node> > preorder_iterator;
+    typedef TreeIterator<Node, PostOrder<Node> > postorder_iterator;
+
     BinaryTree();                                   // constructor
     ~BinaryTree();                                  // destructor
+    // 复制是O(n)的深拷贝；需要O(1)快照时用PersistentTree（见PersistentTree.h）
     BinaryTree(const BinaryTree &);                 // copy constructor
     BinaryTree& operator=(const BinaryTree &);      // copy assignment operator
+    // 移动之后rhs为空树；指向rhs的迭代器失效
+    BinaryTree(BinaryTree &&rhs) noexcept: _root(rhs._root), _size(rhs._size), _alloc(std::move(rhs._alloc)), _comp(rhs._comp) {
+        rhs._root = nullptr;
+        rhs._size = 0;
+    }
+    BinaryTree& operator=(BinaryTree &&rhs) noexcept {
+        if (this != &rhs) {
+            clear();
+            _root = rhs._root;
+            _size = rhs._size;
+            _alloc = std::move(rhs._alloc);
+            _comp = rhs._comp;
+            rhs._root = nullptr;
+            rhs._size = 0;
+        }
+        return *this;
+    }
 
     void insert(const elemType &elem);
     void remove(const elemType &elem);
     void remove_root();
 
-    bool empty() { return _root == nullptr; }
+    bool empty() const { return _root == nullptr; }
+    // 元素类型平凡可析构且分配策略支持整体回收时，不必逐个节点析构，只释放内存池的slab
     void clear() {
         if (_root) {
-            clear(_root);
+            if (!is_trivially_destructible<elemType>::value || !Alloc<Node>::releases_all) clear(_root);
+            _alloc.release();
             _root = nullptr;
+            _size = 0;
         }
     }
+    // 查找。key可以是elemType；Compare透明时也可以是任何能与elemType比较的类型，
+    // 例如BinaryTree<string>可以直接用string_view或const char*查找，不必先构造一个临时的string
+    iterator find(const elemType &key) const { return make_iterator(find_node(key)); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K &key) const { return make_iterator(find_node(key)); }
+    bool contains(const elemType &key) const { return find_node(key) != nullptr; }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K &key) const { return find_node(key) != nullptr; }
+    // key被插入的次数（即节点的_cnt），不在树中时为0
+    int count(const elemType &key) const { return node_count(find_node(key)); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    int count(const K &key) const { return node_count(find_node(key)); }
+    // 第一个不小于key的元素
+    iterator lower_bound(const elemType &key) const { return make_iterator(bound_node(key, false)); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const K &key) const { return make_iterator(bound_node(key, false)); }
+    // 第一个大于key的元素
+    iterator upper_bound(const elemType &key) const { return make_iterator(bound_node(key, true)); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator upper_bound(const K &key) const { return make_iterator(bound_node(key, true)); }
+
+    // 顺序统计，需要Augment = OrderStatistic，都是O(树高)。重复插入的元素按_cnt计算多次
+    // 小于key的元素个数
+    size_t rank(const elemType &key) const { return rank_of(key); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    size_t rank(const K &key) const { return rank_of(key); }
+    // 从小到大的第k个元素（从0开始），k >= total()时返回end()
+    iterator select(size_t k) const;
+    // 落在[lo, hi)中的元素个数
+    size_t count_range(const elemType &lo, const elemType &hi) const { return range_of(lo, hi); }
+    template <typename K1, typename K2, typename C = Compare, typename = typename C::is_transparent>
+    size_t count_range(const K1 &lo, const K2 &hi) const { return range_of(lo, hi); }
+    // 元素总数
+    size_t total() const {
+        static_assert(Augment::enabled, "total() requires Augment = OrderStatistic");
+        return Augment::weight(_root);
+    }
+
+    // 不同元素的个数
+    size_t size() const { return _size; }
+    // 只读快照：不含指针的Eytzinger布局，查找更快，接口相同（见FrozenTree.h）
+    FrozenTree<elemType, Compare> freeze() const { return FrozenTree<elemType, Compare>(begin(), _size, _comp); }
+
+    // 保存到文件、从文件读回（格式见TreeFile.h），读回是O(n)的，得到的树是完全平衡的。
+    // 元素类型平凡可复制时，还可以用treefile::map_frozen()把文件直接映射成只读的FrozenTree
+    void save(const char *path) const;
+    static BinaryTree load(const char *path, const Compare &comp = Compare());
+
+    // 由已经排好序的[first, last)（前向迭代器）批量构建，O(n)，得到的树是完全平衡的。
+    // 相等的元素合并成一个节点，计入_cnt；迭代器带有count()时（如另一棵树的迭代器）按它累加
+    template <typename Iterator>
+    static BinaryTree from_sorted(Iterator first, Iterator last, const Compare &comp = Compare());
+    // 集合运算：归并两棵树的中序序列再批量构建，O(|a| + |b|)。把_cnt看作重数：
+    // 并集的重数相加（等于把b的每次插入都做到a上），交集取较小者，差集为a的减去b的，不大于0时去掉
+    static BinaryTree set_union(const BinaryTree &a, const BinaryTree &b) {
+        return merge(a, b, [](int ca, int cb) { return ca + cb; });
+    }
+    static BinaryTree set_intersection(const BinaryTree &a, const BinaryTree &b) {
+        return merge(a, b, [](int ca, int cb) { return ca < cb ? ca : cb; });
+    }
+    static BinaryTree set_difference(const BinaryTree &a, const BinaryTree &b) {
+        return merge(a, b, [](int ca, int cb) { return ca - cb; });
+    }
+
+    // 树高：空树为0
+    int height() const { return Node::height(_root); }
+
+    // 迭代器：begin()/end()按中序，可以直接用于<algorithm>和range-for
+    iterator begin() const { return iterator(InOrder<Node>::first(_root), &_root); }
+    iterator end() const { return iterator(nullptr, &_root); }
+    reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    reverse_iterator rend() const { return reverse_iterator(begin()); }
+    // 前序、后序遍历，如for (const auto &x : tree.pre_order())
+    TreeRange<preorder_iterator> pre_order() const {
+        return {preorder_iterator(PreOrder<Node>::first(_root), &_root), preorder_iterator(nullptr, &_root)};
+    }
+    TreeRange<postorder_iterator> post_order() const {
+        return {postorder_iterator(PostOrder<Node>::first(_root), &_root), postorder_iterator(nullptr, &_root)};
+    }
 
     // 遍历
-    void preorder(ostream &os = cout) const { _root->preorder(_root, os); }
-    void inorder(ostream &os = cout) const { _root->inorder(_root, os); }
-    void postorder(ostream &os = cout) const { _root->postorder(_root, os); }
+    void preorder(ostream &os = cout) const { print(pre_order(), os); }
+    void inorder(ostream &os = cout) const { print(TreeRange<iterator>{begin(), end()}, os); }
+    void postorder(ostream &os = cout) const { print(post_order(), os); }
 
 private:
-    BinaryTreeNode<elemType> *_root;
-    // 将src所指向的子树复制到tar所指向的子树
-    void copy(BinaryTreeNode<elemType>* tar, BinaryTreeNode<elemType>* src) {
-        tar->_val = src->_val;
-        tar->_cnt = src->_cnt;
-        tar->_l_child = src->_l_child;
-        tar->_r_child = src->_r_child;
+    Node *_root;
+    size_t _size;
+    Alloc<Node> _alloc;
+    Compare _comp;
+
+    template <typename K> Node* find_node(const K &key) const;
+    // upper为false时返回第一个不小于key的节点，为true时返回第一个大于key的节点
+    template <typename K> Node* bound_node(const K &key, bool upper) const;
+    template <typename K> size_t rank_of(const K &key) const;
+    template <typename K1, typename K2> size_t range_of(const K1 &lo, const K2 &hi) const {
+        return _comp(lo, hi) ? rank_of(hi) - rank_of(lo) : 0;
     }
-    void clear(BinaryTreeNode<elemType>*);
+    iterator make_iterator(Node *node) const { return iterator(node, &_root); }
+    static int node_count(const Node *node) { return node ? node->_cnt : 0; }
+    // 复制src所指向的子树（逐个节点，形状不变），返回新的子树根
+    Node* copy(const Node *src);
+    void clear(Node*);
+    // 每次调用next()按中序取出下一个(值的地址, 计数)，用前n个建成完全平衡的子树，返回它的根
+    template <typename Next> Node* build(size_t n, Next &next);
+    // 归并a、b的中序序列，相等的元素的计数由cnt(a中的计数, b中的计数)决定（只在一边时另一边为0），结果不大于0的去掉
+    template <typename Count> static BinaryTree merge(const BinaryTree &a, const BinaryTree &b, Count cnt);
+    template <typename Range> static void print(const Range &range, ostream &os) {
+        for (const elemType &elem : range) os << elem << " ";
+    }
+    void remove_node(Node*);
+    // 用v取代u在树中的位置（只改u的父节点一侧的链接）
+    void replace(Node *u, Node *v);
+    // 从node开始逐层向上调整高度并做平衡，直到根节点
+    void rebalance_from(Node *node);
 };
 
 // 在类外定义类模版成员函数，首先需要带上template <typename elemType>，
 // 然后，类作用域是BinaryTree<elemType>::而非BinaryTree::。
-template <typename elemType>
-inline BinaryTree<elemType>::BinaryTree(): _root(nullptr) {}
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+inline BinaryTree<elemType, Balance, Alloc, Compare, Augment>::BinaryTree(): _root(nullptr), _size(0) {}
 
-template <typename elemType>
-inline BinaryTree<elemType>::BinaryTree(const BinaryTree &rhs) {
-    copy(_root, rhs._root);
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+inline BinaryTree<elemType, Balance, Alloc, Compare, Augment>::BinaryTree(const BinaryTree &rhs):
+_root(nullptr), _size(rhs._size), _comp(rhs._comp) {
+    _root = copy(rhs._root);
 }
 
-template <typename elemType>
-inline BinaryTree<elemType>::~BinaryTree() {
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+inline BinaryTree<elemType, Balance, Alloc, Compare, Augment>::~BinaryTree() {
     clear();
 }
 
-template <typename elemType>
-inline BinaryTree<elemType>& BinaryTree<elemType>::operator=(const BinaryTree &rhs) {
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment>
+inline BinaryTree<elemType, Balance, Alloc, Compare, Augment>& BinaryTree<elemType, Balance, Alloc, Compare, Augment>::operator=(const BinaryTree &rhs) {
     if (this != &rhs) {
         clear();
-        copy(_root, rhs._root);
+        _root = copy(rhs._root);
+        _size = rhs._size;
+        _comp = rhs._comp;
     }
     return *this;
 }
 
+// 模版的定义必须在实例化它的地方可见，所以程序代码文件要被包含进来（见readme.md）
+#include "BinaryTree.cpp"
+
 #endif //CODING_BINARYTREE_H
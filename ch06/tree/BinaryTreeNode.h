@@ -8,52 +8,46 @@
 #include <iostream>
 using namespace std;
 
-template <typename elemType> class BinaryTree;
+#include "Augment.h"
+
+template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Augment> class BinaryTree;
 
 // 模版类：二叉树节点
 // valType指定了节点内存放的数值的数据类型
-template <typename valType>
-class BinaryTreeNode {
+// Augment是节点的扩充信息（见Augment.h），节点从Augment::Data继承它的字段
+template <typename valType, typename Augment = NoAugment>
+class BinaryTreeNode : public Augment::Data {
     // 我们还没有定义类BinaryTree的具体内容，因此必须要有前置声明，否则这里报错（"找不到类BinaryTree"）
-    friend class BinaryTree<valType>;
+    template <typename elemType, typename Balance, template <typename> class Alloc, typename Compare, typename Aug> friend class BinaryTree;
 
 public:
-    explicit BinaryTreeNode(const valType &);
+    typedef valType value_type;
+
+    explicit BinaryTreeNode(const valType &, BinaryTreeNode *parent = nullptr);
 
-    void insert_value(const valType &);
-    static void left_child_leaf(BinaryTreeNode *, BinaryTreeNode *);
-    // 第二个参数是reference to pointer，如果去掉&，那么只能更改该pointer所指向的对象；
-    // 如果加上&，那么还可以更改该pointer本身！
-    void remove_value(const valType &, BinaryTreeNode* &);
+    const valType& value() const { return _val; }
+    int count() const { return _cnt; }
+    BinaryTreeNode* l_child() const { return _l_child; }
+    BinaryTreeNode* r_child() const { return _r_child; }
+    BinaryTreeNode* parent() const { return _parent; }
 
-    // 遍历
-    void preorder(BinaryTreeNode *node, ostream &os = cout) const {
-        if (node) {
-            os << node->_val << " ";
-            if (node->_l_child) preorder(node->_l_child, os);
-            if (node->_r_child) preorder(node->_r_child, os);
-        }
-    }
-    void inorder(BinaryTreeNode *node, ostream &os = cout) const {
-        if (node) {
-            if (node->_l_child) inorder(node->_l_child, os);
-            os << node->_val << " ";
-            if (node->_r_child) inorder(node->_r_child, os);
-        }
-    }
-    void postorder(BinaryTreeNode *node, ostream &os = cout) const {
-        if (node) {
-            if (node->_l_child) postorder(node->_l_child, os);
-            if (node->_r_child) postorder(node->_r_child, os);
-            os << node->_val << " ";
-        }
-    }
+    // 以下静态函数供平衡策略（见Balance.h）使用
+    // 空子树的高度为0，叶节点为1
+    static int height(const BinaryTreeNode *node) { return node ? node->_height : 0; }
+    // 子节点的高度（以及扩充信息）已经正确时，重新计算node的
+    static void update(BinaryTreeNode *node);
+    // 旋转以node为根的子树，返回新的子树根，并把它接回node原来的父节点上
+    static BinaryTreeNode* rotate_left(BinaryTreeNode *node);
+    static BinaryTreeNode* rotate_right(BinaryTreeNode *node);
 
 private:
     valType _val;
     int _cnt;
+    int _height;
     BinaryTreeNode *_l_child;
     BinaryTreeNode *_r_child;
+    // 指向父节点，插入和删除之后沿着它向上调整高度、做平衡
+    BinaryTreeNode *_parent;
 };
 
 
@@ -61,10 +55,13 @@ private:
 // 建议选择成员列表的方式初始化valType类型的对象_val。这是因为valType可能是一个类而非内置数据类型
 // 因此将其声明为const reference，并通过copy constructor直接赋给_val是最快的（避免以传值的方式传递参数）。
 // 经验总结：将所有的template类型参数视为"class类型"并通过传址的方式来处理。
-template <typename valType>
-inline BinaryTreeNode<valType>::BinaryTreeNode(const valType &val): _val(val) {
+template <typename valType, typename Augment>
+inline BinaryTreeNode<valType, Augment>::BinaryTreeNode(const valType &val, BinaryTreeNode *parent): _val(val) {
     _cnt = 1;
+    _height = 1;
     _l_child = _r_child = nullptr;
+    _parent = parent;
+    Augment::update(this);
 }
 //template <typename valType>
 //inline BinaryTreeNode<valType>::BinaryTreeNode(const valType &val) {
@@ -73,5 +70,7 @@ inline BinaryTreeNode<valType>::BinaryTreeNode(const valType &val): _val(val) {
 //    _l_child = _r_child = nullptr;
 //}
 
+// 模版的定义必须在实例化它的地方可见，所以程序代码文件要被包含进来（见readme.md）
+#include "BinaryTreeNode.cpp"
 
 #endif //CODING_BINARYTREENODE_H
@@ -0,0 +1,313 @@
+#ifndef CODING_CONCURRENTTREE_H
+#define CODING_CONCURRENTTREE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "Epoch.h"
+
+// 多读者、少写者共享的AVL树。
+// 节点一经发布就不再修改：写者沿查找路径复制节点（path copying），在副本上完成插入/删除和旋转，
+// 最后用一次原子写把新的根发布出去；被替换下来的旧节点交给Epoch延迟释放。
+// 因此读者只需在Epoch::Guard中读一次根指针，之后看到的是一棵完整、不变的树：
+// 查找和遍历不加锁、不重试、不等待写者（wait-free），也永远不会看到做了一半的旋转。
+// 写者之间用一个互斥量串行化：新根的发布就是写操作的线性化点，读者完全不参与这把锁。
+// 这里有意不用细粒度锁或乐观验证：path copying下每次写操作都要复制根节点、发布新的根，
+// 任意两个写操作无论改动树的哪一部分都在根上冲突，细粒度锁无法让它们并行；
+// 乐观地CAS根指针则在冲突时要丢弃已经复制好的O(log n)个节点、重做旋转，写者越多浪费越大。
+// 一把写锁的代价只落在写者身上，读者既不加锁也不重试。
+// 每次写操作只新建O(log n)个节点。
+template <typename elemType, typename Compare = std::less<> >
+class ConcurrentTree {
+    struct Node {
+        elemType val;
+        int cnt;
+        int height;
+        Node *l;
+        Node *r;
+        uint64_t born;      // 新建它的写操作的序号，只由写者读写
+        Node(const elemType &v, int c, Node *lc, Node *rc, uint64_t b): val(v), cnt(c), l(lc), r(rc), born(b) { update(); }
+        void update() {
+            int lh = l ? l->height : 0, rh = r ? r->height : 0;
+            height = (lh > rh ? lh : rh) + 1;
+        }
+    };
+
+public:
+    class View;
+    class iterator;
+
+    ConcurrentTree(): _root(nullptr), _writes(0) {}
+    // 析构时不能再有读者
+    ~ConcurrentTree() { destroy(_root.load(std::memory_order_relaxed)); }
+    ConcurrentTree(const ConcurrentTree &) = delete;
+    ConcurrentTree& operator=(const ConcurrentTree &) = delete;
+
+    // 写操作：写者之间串行
+    void insert(const elemType &elem) {
+        std::lock_guard<std::mutex> lock(_write_mutex);
+        _writes++;
+        _root.store(insert(_root.load(std::memory_order_relaxed), elem), std::memory_order_seq_cst);
+        flush();
+    }
+    void remove(const elemType &elem) {
+        std::lock_guard<std::mutex> lock(_write_mutex);
+        _writes++;
+        bool removed = false;
+        Node *root = remove(_root.load(std::memory_order_relaxed), elem, removed);
+        if (removed) _root.store(root, std::memory_order_seq_cst);
+        flush();
+    }
+
+    // 读操作：在一个一致的快照上完成，wait-free
+    View view() const { return View(this); }
+    template <typename K> bool contains(const K &key) const { return view().contains(key); }
+    template <typename K> int count(const K &key) const { return view().count(key); }
+
+    // 中序迭代器。节点没有父指针，用定长的栈记录还没访问的祖先：AVL树的高度不超过1.44 * log2(n + 2)，
+    // 对任何能放进内存的n都小于MAX_DEPTH，所以遍历不做堆分配
+    class iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef elemType value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const elemType* pointer;
+        typedef const elemType& reference;
+
+        iterator(): _top(0) {}
+        reference operator*() const { return _stack[_top - 1]->val; }
+        pointer operator->() const { return &_stack[_top - 1]->val; }
+        int count() const { return _stack[_top - 1]->cnt; }
+        iterator& operator++() {
+            Node *node = _stack[--_top];
+            push_left(node->r);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const iterator &rhs) const {
+            return _top == rhs._top && (_top == 0 || _stack[_top - 1] == rhs._stack[_top - 1]);
+        }
+        bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+
+    private:
+        friend class View;
+        static const int MAX_DEPTH = 96;
+
+        void push(Node *node) { _stack[_top++] = node; }
+        void push_left(Node *node) {
+            for (; node; node = node->l) push(node);
+        }
+
+        Node *_stack[MAX_DEPTH];
+        int _top;
+    };
+
+    // 读者的快照：持有一个Epoch::Guard和当时的根。View存在期间它看到的节点都不会被释放，
+    // 但也看不到之后的写入；不要长时间持有，否则旧节点无法回收
+    class View {
+    public:
+        View(View &&rhs) noexcept: _root(rhs._root), _comp(rhs._comp), _active(rhs._active) { rhs._active = false; }
+        View(const View &) = delete;
+        View& operator=(const View &) = delete;
+        ~View() { if (_active) Epoch::exit(); }
+
+        iterator begin() const {
+            iterator it;
+            it.push_left(_root);
+            return it;
+        }
+        iterator end() const { return iterator(); }
+
+        template <typename K> bool contains(const K &key) const { return find_node(key) != nullptr; }
+        template <typename K> int count(const K &key) const {
+            Node *node = find_node(key);
+            return node ? node->cnt : 0;
+        }
+        template <typename K> iterator find(const K &key) const {
+            iterator it = lower_bound(key);
+            return it != end() && !_comp(key, *it) ? it : end();
+        }
+        // 下降时把"向左走"经过的节点压栈，栈顶即为结果，迭代器可以从这里继续往后走
+        template <typename K> iterator lower_bound(const K &key) const {
+            iterator it;
+            for (Node *node = _root; node;) {
+                if (_comp(node->val, key)) node = node->r;
+                else {
+                    it.push(node);
+                    node = node->l;
+                }
+            }
+            return it;
+        }
+        template <typename K> iterator upper_bound(const K &key) const {
+            iterator it;
+            for (Node *node = _root; node;) {
+                if (!_comp(key, node->val)) node = node->r;
+                else {
+                    it.push(node);
+                    node = node->l;
+                }
+            }
+            return it;
+        }
+
+    private:
+        friend class ConcurrentTree;
+        explicit View(const ConcurrentTree *tree): _comp(tree->_comp), _active(true) {
+            Epoch::enter();
+            _root = tree->_root.load(std::memory_order_seq_cst);
+        }
+
+        template <typename K> Node* find_node(const K &key) const {
+            Node *node = _root;
+            while (node) {
+                if (_comp(key, node->val)) node = node->l;
+                else if (_comp(node->val, key)) node = node->r;
+                else return node;
+            }
+            return nullptr;
+        }
+
+        Node *_root;
+        Compare _comp;
+        bool _active;
+    };
+
+private:
+    static int height(const Node *node) { return node ? node->height : 0; }
+    Node* make(const elemType &v, int c, Node *l, Node *r) { return new Node(v, c, l, r, _writes); }
+    // 被替换下来的节点：本次写操作新建、还没有发布的节点没有读者能看到，直接释放；
+    // 已经发布的先攒在_garbage里，新根发布之后一次交给Epoch
+    void retire(Node *node) {
+        if (node->born == _writes) delete node;
+        else _garbage.push_back(node);
+    }
+    void flush() {
+        if (!_garbage.empty()) {
+            Epoch::retire(_garbage.data(), _garbage.size(), [](void *p) { delete static_cast<Node *>(p); });
+            _garbage.clear();
+        }
+    }
+
+    // 以下函数只由持有_write_mutex的写者调用。
+    // 参数中新建的节点（尚未发布）可以直接修改；已经发布的节点只能复制，旧的交给retire()。
+    // 调用retire(x)之前必须已经读完x的各个成员
+
+    // node是本次新建的节点，子树已经正确；返回平衡之后的子树根
+    Node* balance(Node *node) {
+        node->update();
+        int diff = height(node->l) - height(node->r);
+        if (diff > 1) {
+            Node *l = node->l;
+            if (height(l->l) < height(l->r)) {
+                // LR型：l的右子节点lr成为新的根
+                Node *lr = l->r;
+                Node *a = make(l->val, l->cnt, l->l, lr->l);
+                node->l = lr->r;
+                node->update();
+                Node *root = make(lr->val, lr->cnt, a, node);
+                retire(l);
+                retire(lr);
+                return root;
+            }
+            node->l = l->r;
+            node->update();
+            Node *root = make(l->val, l->cnt, l->l, node);
+            retire(l);
+            return root;
+        }
+        if (diff < -1) {
+            Node *r = node->r;
+            if (height(r->r) < height(r->l)) {
+                Node *rl = r->l;
+                Node *b = make(r->val, r->cnt, rl->r, r->r);
+                node->r = rl->l;
+                node->update();
+                Node *root = make(rl->val, rl->cnt, node, b);
+                retire(r);
+                retire(rl);
+                return root;
+            }
+            node->r = r->l;
+            node->update();
+            Node *root = make(r->val, r->cnt, node, r->r);
+            retire(r);
+            return root;
+        }
+        return node;
+    }
+
+    Node* insert(Node *node, const elemType &elem) {
+        if (!node) return make(elem, 1, nullptr, nullptr);
+        Node *copy;
+        if (_comp(elem, node->val)) copy = make(node->val, node->cnt, insert(node->l, elem), node->r);
+        else if (_comp(node->val, elem)) copy = make(node->val, node->cnt, node->l, insert(node->r, elem));
+        else copy = make(node->val, node->cnt + 1, node->l, node->r);
+        retire(node);
+        return balance(copy);
+    }
+
+    // 删除以node为根的子树中最小的节点，min取得它（调用者负责retire）
+    Node* remove_min(Node *node, Node *&min) {
+        if (!node->l) {
+            min = node;
+            return node->r;
+        }
+        Node *copy = make(node->val, node->cnt, remove_min(node->l, min), node->r);
+        retire(node);
+        return balance(copy);
+    }
+
+    // 不在树中时原样返回，不复制任何节点
+    Node* remove(Node *node, const elemType &elem, bool &removed) {
+        if (!node) return nullptr;
+        Node *copy;
+        if (_comp(elem, node->val)) {
+            Node *l = remove(node->l, elem, removed);
+            if (!removed) return node;
+            copy = make(node->val, node->cnt, l, node->r);
+        } else if (_comp(node->val, elem)) {
+            Node *r = remove(node->r, elem, removed);
+            if (!removed) return node;
+            copy = make(node->val, node->cnt, node->l, r);
+        } else {
+            removed = true;
+            Node *l = node->l, *r = node->r;
+            retire(node);
+            if (!l) return r;
+            if (!r) return l;
+            // 以后继取代被删除的节点
+            Node *succ;
+            r = remove_min(r, succ);
+            copy = make(succ->val, succ->cnt, l, r);
+            retire(succ);
+            return balance(copy);
+        }
+        retire(node);
+        return balance(copy);
+    }
+
+    static void destroy(Node *node) {
+        if (node) {
+            destroy(node->l);
+            destroy(node->r);
+            delete node;
+        }
+    }
+
+    std::atomic<Node *> _root;
+    std::mutex _write_mutex;
+    std::vector<void *> _garbage;   // 受_write_mutex保护
+    uint64_t _writes;               // 写操作的序号，受_write_mutex保护
+    Compare _comp;
+};
+
+#endif //CODING_CONCURRENTTREE_H
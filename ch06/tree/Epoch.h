@@ -0,0 +1,140 @@
+#ifndef CODING_EPOCH_H
+#define CODING_EPOCH_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+// 基于epoch的内存回收（EBR）。
+// 读者在访问共享结构之前用Epoch::Guard声明"我正处于第e个epoch"，离开时撤销声明；
+// 这只是一次读、一次写和一个内存屏障，不加锁、不等待任何人（wait-free）。
+// 写者把已经从结构中摘下来的对象交给retire()，标上当时的全局epoch e。
+// 只有当所有正在读的线程都已经进入epoch e + 1时，全局epoch才能前进，
+// 所以全局epoch到达e + 2时，摘下对象之前就已经开始的读者必然都已离开，此时才真正释放。
+class Epoch {
+public:
+    static const int MAX_THREADS = 256;
+
+    // 读者的临界区，可以嵌套
+    class Guard {
+    public:
+        Guard() { enter(); }
+        ~Guard() { exit(); }
+        Guard(const Guard &) = delete;
+        Guard& operator=(const Guard &) = delete;
+    };
+
+    static void enter() {
+        Slot &s = slot();
+        if (s.depth++ == 0) {
+            // 声明必须在读取共享指针之前对写者可见：这里与读者随后对共享指针的读取、
+            // 写者对共享指针的发布和reclaim()对各槽的读取都是seq_cst，构成全序
+            s.epoch.store(state()._global.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+        }
+    }
+
+    static void exit() {
+        Slot &s = slot();
+        if (--s.depth == 0) s.epoch.store(IDLE, std::memory_order_release);
+    }
+
+    // p已经不可能被新的读者看到；等到所有可能还在读它的线程离开后调用deleter(p)
+    static void retire(void *p, void (*deleter)(void *)) {
+        State &st = state();
+        std::lock_guard<std::mutex> lock(st._mutex);
+        st._retired.push_back(Retired{st._global.load(std::memory_order_relaxed), p, deleter});
+        if (st._retired.size() >= RECLAIM_BATCH) reclaim(st);
+    }
+    // 一次交出一批（一次写操作摘下的全部对象），只加一次锁
+    static void retire(void *const *first, size_t n, void (*deleter)(void *)) {
+        State &st = state();
+        std::lock_guard<std::mutex> lock(st._mutex);
+        uint64_t e = st._global.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < n; i++) st._retired.push_back(Retired{e, first[i], deleter});
+        if (st._retired.size() >= RECLAIM_BATCH) reclaim(st);
+    }
+
+    // 尽可能回收（写者空闲时可以调用）
+    static void collect() {
+        State &st = state();
+        std::lock_guard<std::mutex> lock(st._mutex);
+        reclaim(st);
+    }
+
+    // 尚未释放的对象个数
+    static size_t pending() {
+        State &st = state();
+        std::lock_guard<std::mutex> lock(st._mutex);
+        return st._retired.size();
+    }
+
+private:
+    static const uint64_t IDLE = ~uint64_t(0);
+    static const size_t RECLAIM_BATCH = 256;
+
+    // 每个线程一个槽，独占一个缓存行，避免读者之间的伪共享
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> used{false};
+        int depth = 0;
+    };
+    struct Retired {
+        uint64_t epoch;
+        void *p;
+        void (*deleter)(void *);
+    };
+    struct State {
+        std::atomic<uint64_t> _global{0};
+        Slot _slots[MAX_THREADS];
+        std::mutex _mutex;              // 保护_retired，只有写者会用到
+        std::vector<Retired> _retired;
+    };
+    // 线程退出时归还它的槽
+    struct Owner {
+        Slot *slot = nullptr;
+        ~Owner() { if (slot) slot->used.store(false, std::memory_order_release); }
+    };
+
+    static State& state() {
+        static State st;
+        return st;
+    }
+
+    static Slot& slot() {
+        thread_local Owner owner;
+        if (!owner.slot) {
+            State &st = state();
+            for (int i = 0; i < MAX_THREADS && !owner.slot; i++) {
+                bool expected = false;
+                if (st._slots[i].used.compare_exchange_strong(expected, true)) owner.slot = &st._slots[i];
+            }
+            if (!owner.slot) {
+                std::cerr << "Epoch: more than " << MAX_THREADS << " threads" << std::endl;
+                std::exit(-1);
+            }
+        }
+        return *owner.slot;
+    }
+
+    // 所有正在读的线程都处于当前epoch时前进一步，然后释放两个epoch以前摘下的对象
+    static void reclaim(State &st) {
+        uint64_t e = st._global.load(std::memory_order_relaxed);
+        bool quiescent = true;
+        for (int i = 0; i < MAX_THREADS && quiescent; i++) {
+            uint64_t local = st._slots[i].epoch.load(std::memory_order_seq_cst);
+            if (local != IDLE && local != e) quiescent = false;
+        }
+        if (quiescent) st._global.store(++e, std::memory_order_release);
+        size_t kept = 0;
+        for (Retired &r : st._retired) {
+            if (r.epoch + 2 <= e) r.deleter(r.p);
+            else st._retired[kept++] = r;
+        }
+        st._retired.resize(kept);
+    }
+};
+
+#endif //CODING_EPOCH_H
@@ -0,0 +1,213 @@
+#ifndef CODING_FROZENTREE_H
+#define CODING_FROZENTREE_H
+
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <new>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+// 只读的二叉搜索树快照（BinaryTree::freeze()的结果），按Eytzinger布局存放在一个数组里：
+// 下标从1开始，节点k的左右子节点是2k和2k+1（即完全二叉树的层序）。
+// 查找时没有指针可追，下一层要访问的位置可以直接算出来：每一步都预取k * L处的缓存行
+// （L为一个缓存行能放下的元素个数），它恰好装着k往下第log2(L)层的全部L个后代，
+// 于是访存延迟被几层比较的时间掩盖掉，而不是像指针树那样每一层等一次缓存缺失。
+// 中序的前驱、后继也可以由下标算出，所以同样支持双向迭代。
+
+// 按缓存行对齐的分配器，使下标k * L处的L个元素正好落在同一个缓存行里
+template <typename T>
+struct CacheAligned {
+    typedef T value_type;
+    static const size_t LINE = 64;
+
+    CacheAligned() = default;
+    template <typename U> CacheAligned(const CacheAligned<U> &) {}
+    T* allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(LINE))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(LINE)); }
+    template <typename U> bool operator==(const CacheAligned<U> &) const { return true; }
+    template <typename U> bool operator!=(const CacheAligned<U> &) const { return false; }
+};
+
+// Eytzinger布局（下标从1开始，共n个节点）中按中序的第一个、最后一个、后继与前驱，下标为0表示没有
+namespace eytzinger {
+
+inline size_t first(size_t n) {
+    size_t k = n ? 1 : 0;
+    while (2 * k <= n && k) k = 2 * k;
+    return k;
+}
+inline size_t last(size_t n) {
+    size_t k = n ? 1 : 0;
+    while (2 * k + 1 <= n && k) k = 2 * k + 1;
+    return k;
+}
+inline size_t next(size_t k, size_t n) {
+    if (2 * k + 1 <= n) {
+        k = 2 * k + 1;
+        while (2 * k <= n) k = 2 * k;
+        return k;
+    }
+    // 作为右子节点一路上去，再上一层就是后继
+    while (k & 1) k >>= 1;
+    return k >> 1;
+}
+inline size_t prev(size_t k, size_t n) {
+    if (2 * k <= n) {
+        k = 2 * k;
+        while (2 * k + 1 <= n) k = 2 * k + 1;
+        return k;
+    }
+    while (!(k & 1)) k >>= 1;
+    return k >> 1;
+}
+
+}
+
+// 迭代器带有count()时取它（BinaryTree的迭代器），否则每个元素计1次
+template <typename Iterator>
+auto count_of(const Iterator &it, int) -> decltype(it.count()) { return it.count(); }
+template <typename Iterator>
+int count_of(const Iterator &, long) { return 1; }
+
+template <typename elemType, typename Compare = std::less<> >
+class FrozenTree {
+public:
+    typedef elemType value_type;
+    class iterator;
+    typedef iterator const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+
+    FrozenTree(): _n(0), _keys(nullptr), _counts(nullptr) {}
+    // 从first开始读n个严格递增的元素
+    template <typename Iterator>
+    FrozenTree(Iterator first, size_t n, const Compare &comp = Compare());
+    // 使用外部的存储（如mmap的文件，见TreeFile.h）：keys[1..n]和counts[1..n]按Eytzinger布局排好，
+    // keys应按缓存行对齐；owner负责这块存储的生命周期
+    FrozenTree(const elemType *keys, const int *counts, size_t n, std::shared_ptr<const void> owner,
+               const Compare &comp = Compare()):
+    _n(n), _keys(keys), _counts(counts), _comp(comp), _owner(std::move(owner)) {}
+    FrozenTree(FrozenTree &&) = default;
+    FrozenTree& operator=(FrozenTree &&) = default;
+    FrozenTree(const FrozenTree &) = delete;
+    FrozenTree& operator=(const FrozenTree &) = delete;
+
+    size_t size() const { return _n; }
+    bool empty() const { return _n == 0; }
+
+    iterator begin() const { return iterator(first(), this); }
+    iterator end() const { return iterator(0, this); }
+    reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+    // 与BinaryTree相同的查找接口，Compare透明时key可以是任何能与elemType比较的类型
+    iterator find(const elemType &key) const { return iterator(find_index(key), this); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K &key) const { return iterator(find_index(key), this); }
+    bool contains(const elemType &key) const { return find_index(key) != 0; }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K &key) const { return find_index(key) != 0; }
+    int count(const elemType &key) const { return index_count(find_index(key)); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    int count(const K &key) const { return index_count(find_index(key)); }
+    iterator lower_bound(const elemType &key) const { return iterator(bound_index<false>(key), this); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const K &key) const { return iterator(bound_index<false>(key), this); }
+    iterator upper_bound(const elemType &key) const { return iterator(bound_index<true>(key), this); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator upper_bound(const K &key) const { return iterator(bound_index<true>(key), this); }
+
+    class iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef elemType value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const elemType* pointer;
+        typedef const elemType& reference;
+
+        iterator(): _k(0), _tree(nullptr) {}
+        iterator(size_t k, const FrozenTree *tree): _k(k), _tree(tree) {}
+
+        reference operator*() const { return _tree->_keys[_k]; }
+        pointer operator->() const { return _tree->_keys + _k; }
+        int count() const { return _tree->_counts[_k]; }
+
+        iterator& operator++() {
+            _k = _tree->next(_k);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        iterator& operator--() {
+            _k = _k ? _tree->prev(_k) : _tree->last();
+            return *this;
+        }
+        iterator operator--(int) {
+            iterator tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator &rhs) const { return _k == rhs._k; }
+        bool operator!=(const iterator &rhs) const { return _k != rhs._k; }
+
+    private:
+        size_t _k;              // Eytzinger下标，0表示end()
+        const FrozenTree *_tree;
+    };
+
+private:
+    // 一个缓存行能放下的元素个数
+    static const size_t PREFETCH = sizeof(elemType) < CacheAligned<elemType>::LINE ? CacheAligned<elemType>::LINE / sizeof(elemType) : 1;
+
+    size_t first() const { return eytzinger::first(_n); }
+    size_t last() const { return eytzinger::last(_n); }
+    size_t next(size_t k) const { return eytzinger::next(k, _n); }
+    size_t prev(size_t k) const { return eytzinger::prev(k, _n); }
+
+    // upper为false时返回第一个不小于key的下标，为true时返回第一个大于key的下标。
+    // 一路比较到叶节点以下（无分支），最后k的二进制表示中，末尾连续的1对应最后几次"向右走"，
+    // 去掉它们和再上面的一位，剩下的就是最后一次"向左走"时所在的节点，即答案
+    template <bool upper, typename K>
+    size_t bound_index(const K &key) const {
+        size_t k = 1;
+        while (k <= _n) {
+            __builtin_prefetch(_keys + k * PREFETCH);
+            k = 2 * k + (upper ? !_comp(key, _keys[k]) : _comp(_keys[k], key));
+        }
+        return k >> __builtin_ffsll(~(long long)k);
+    }
+    template <typename K>
+    size_t find_index(const K &key) const {
+        size_t k = bound_index<false>(key);
+        return k && !_comp(key, _keys[k]) ? k : 0;
+    }
+    int index_count(size_t k) const { return k ? _counts[k] : 0; }
+
+    size_t _n;
+    const elemType *_keys;          // _keys[1.._n]，_keys[0]不用；指向_key_store或外部存储
+    const int *_counts;
+    Compare _comp;
+    std::vector<elemType, CacheAligned<elemType> > _key_store;
+    std::vector<int> _count_store;
+    std::shared_ptr<const void> _owner;     // 使用外部存储时持有它
+};
+
+template <typename elemType, typename Compare>
+template <typename Iterator>
+FrozenTree<elemType, Compare>::FrozenTree(Iterator first_elem, size_t n, const Compare &comp):
+_n(n), _comp(comp), _key_store(n + 1), _count_store(n + 1) {
+    // 按中序依次填入：Eytzinger下标的中序就是从小到大
+    for (size_t k = first(); k; k = next(k), ++first_elem) {
+        _key_store[k] = *first_elem;
+        _count_store[k] = count_of(first_elem, 0);
+    }
+    _keys = _key_store.data();
+    _counts = _count_store.data();
+}
+
+#endif //CODING_FROZENTREE_H
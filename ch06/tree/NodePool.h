@@ -0,0 +1,108 @@
+#ifndef CODING_NODEPOOL_H
+#define CODING_NODEPOOL_H
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+// 二叉树节点的分配策略，作为BinaryTree的模版参数。Alloc<Node>需要提供：
+//   create(args...)   分配并构造一个节点
+//   destroy(node)     析构并回收一个节点
+//   release()         回收所有节点占用的内存（节点必须已经析构，或者是平凡可析构的）
+//   releases_all      release()是否真的会回收全部节点；为false时clear()要逐个destroy
+
+// 内存池（默认）：节点从成块分配的slab中依次切出，相邻插入的节点在内存中也相邻；
+// destroy()回收的节点挂在空闲链表上，下一次create()优先复用。
+// slab从64个节点开始逐次翻倍，最大65536个节点，所以slab的个数是O(log n + n / 65536)，
+// clear()对平凡可析构的元素类型只需释放这些slab，不必逐个节点delete。
+template <typename Node>
+class NodePool {
+public:
+    static const bool releases_all = true;
+
+    NodePool(): _free(nullptr), _next(nullptr), _end(nullptr), _slab_size(FIRST_SLAB) {}
+    NodePool(const NodePool &) = delete;
+    NodePool& operator=(const NodePool &) = delete;
+    // 移动时整体接管slab，节点的地址不变
+    NodePool(NodePool &&rhs) noexcept: NodePool() { swap(rhs); }
+    NodePool& operator=(NodePool &&rhs) noexcept {
+        release();
+        swap(rhs);
+        return *this;
+    }
+    ~NodePool() { release(); }
+
+    template <typename... Args>
+    Node* create(Args&&... args) {
+        Slot *slot;
+        if (_free) {
+            slot = _free;
+            _free = _free->next;
+        } else {
+            if (_next == _end) grow();
+            slot = _next++;
+        }
+        return new (slot->storage) Node(std::forward<Args>(args)...);
+    }
+
+    void destroy(Node *node) {
+        node->~Node();
+        Slot *slot = reinterpret_cast<Slot *>(node);
+        slot->next = _free;
+        _free = slot;
+    }
+
+    void release() {
+        for (Slot *slab : _slabs) delete []slab;
+        _slabs.clear();
+        _free = _next = _end = nullptr;
+        _slab_size = FIRST_SLAB;
+    }
+
+    size_t slabs() const { return _slabs.size(); }
+
+    void swap(NodePool &rhs) noexcept {
+        std::swap(_free, rhs._free);
+        std::swap(_next, rhs._next);
+        std::swap(_end, rhs._end);
+        std::swap(_slab_size, rhs._slab_size);
+        _slabs.swap(rhs._slabs);
+    }
+
+private:
+    static const size_t FIRST_SLAB = 64;
+    static const size_t MAX_SLAB = 65536;
+
+    // 空闲的节点空间借来存放空闲链表的指针
+    union Slot {
+        Slot *next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    void grow() {
+        _next = new Slot[_slab_size];
+        _end = _next + _slab_size;
+        _slabs.push_back(_next);
+        if (_slab_size < MAX_SLAB) _slab_size *= 2;
+    }
+
+    Slot *_free;
+    Slot *_next;        // 当前slab中下一个未用过的位置
+    Slot *_end;
+    size_t _slab_size;
+    std::vector<Slot *> _slabs;
+};
+
+// 每个节点单独new/delete
+template <typename Node>
+struct NewDelete {
+    static const bool releases_all = false;
+
+    template <typename... Args>
+    Node* create(Args&&... args) { return new Node(std::forward<Args>(args)...); }
+    void destroy(Node *node) { delete node; }
+    void release() {}
+};
+
+#endif //CODING_NODEPOOL_H
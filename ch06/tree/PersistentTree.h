@@ -0,0 +1,291 @@
+#ifndef CODING_PERSISTENTTREE_H
+#define CODING_PERSISTENTTREE_H
+
+#include <atomic>
+#include <iterator>
+#include <functional>
+#include <cstddef>
+
+// 持久化（copy-on-write）的AVL树：复制一棵树是O(1)的，只是让两棵树共享同一个根。
+// 节点带有引用计数，被几棵树（或几个父节点）共享就记几次；修改时沿查找路径往下，
+// 遇到被共享的节点就复制一份（path copying），独占的节点直接原地修改。
+// 所以没有快照时插入、删除不做额外的分配，有快照时每次修改最多新建O(树高)个节点，其余部分继续共享。
+// 节点可能被多棵树共享，没有唯一的父节点，所以没有父指针，也不能用BinaryTree按树分配的内存池。
+// 引用计数是原子的：不同的PersistentTree对象（即使共享节点）可以在不同线程中同时使用；
+// 同一个对象和标准容器一样，不能同时读写。
+template <typename elemType, typename Compare = std::less<> >
+class PersistentTree {
+    struct Node {
+        elemType val;
+        int cnt;
+        int height;
+        std::atomic<int> refs;
+        Node *l;
+        Node *r;
+        explicit Node(const elemType &v): val(v), cnt(1), height(1), refs(1), l(nullptr), r(nullptr) {}
+        // 复制一个被共享的节点：子树仍然共享，所以子节点各多一个引用
+        explicit Node(const Node &rhs): val(rhs.val), cnt(rhs.cnt), height(rhs.height), refs(1), l(rhs.l), r(rhs.r) {
+            acquire(l);
+            acquire(r);
+        }
+    };
+
+public:
+    typedef elemType value_type;
+    class iterator;
+    typedef iterator const_iterator;
+
+    PersistentTree(): _root(nullptr), _size(0) {}
+    ~PersistentTree() { release(_root); }
+    // 复制即快照：O(1)
+    PersistentTree(const PersistentTree &rhs): _root(rhs._root), _size(rhs._size), _comp(rhs._comp) { acquire(_root); }
+    PersistentTree& operator=(const PersistentTree &rhs) {
+        acquire(rhs._root);
+        release(_root);
+        _root = rhs._root;
+        _size = rhs._size;
+        _comp = rhs._comp;
+        return *this;
+    }
+    PersistentTree(PersistentTree &&rhs) noexcept: _root(rhs._root), _size(rhs._size), _comp(rhs._comp) {
+        rhs._root = nullptr;
+        rhs._size = 0;
+    }
+    PersistentTree& operator=(PersistentTree &&rhs) noexcept {
+        if (this != &rhs) {
+            release(_root);
+            _root = rhs._root;
+            _size = rhs._size;
+            _comp = rhs._comp;
+            rhs._root = nullptr;
+            rhs._size = 0;
+        }
+        return *this;
+    }
+    PersistentTree snapshot() const { return *this; }
+
+    void insert(const elemType &elem) { _root = insert(_root, elem); }
+    // 不在树中时什么也不做，也不复制节点
+    void remove(const elemType &elem) {
+        if (find_node(elem)) {
+            _root = remove(_root, elem);
+            _size--;
+        }
+    }
+    void clear() {
+        release(_root);
+        _root = nullptr;
+        _size = 0;
+    }
+
+    bool empty() const { return _root == nullptr; }
+    // 不同元素的个数
+    size_t size() const { return _size; }
+    int height() const { return height(_root); }
+
+    // 与BinaryTree相同的查找接口，Compare透明时key可以是任何能与elemType比较的类型
+    template <typename K> bool contains(const K &key) const { return find_node(key) != nullptr; }
+    template <typename K> int count(const K &key) const {
+        Node *node = find_node(key);
+        return node ? node->cnt : 0;
+    }
+    template <typename K> iterator find(const K &key) const {
+        iterator it = lower_bound(key);
+        return it != end() && !_comp(key, *it) ? it : end();
+    }
+    template <typename K> iterator lower_bound(const K &key) const {
+        iterator it;
+        for (Node *node = _root; node;) {
+            if (_comp(node->val, key)) node = node->r;
+            else {
+                it.push(node);
+                node = node->l;
+            }
+        }
+        return it;
+    }
+    template <typename K> iterator upper_bound(const K &key) const {
+        iterator it;
+        for (Node *node = _root; node;) {
+            if (!_comp(key, node->val)) node = node->r;
+            else {
+                it.push(node);
+                node = node->l;
+            }
+        }
+        return it;
+    }
+
+    iterator begin() const {
+        iterator it;
+        it.push_left(_root);
+        return it;
+    }
+    iterator end() const { return iterator(); }
+
+    // 中序迭代器。没有父指针，用定长的栈记录还没访问的祖先（AVL树的高度远小于MAX_DEPTH），不做堆分配。
+    // 修改一棵树会使它的迭代器失效（独占的节点是原地修改的），快照的迭代器不受影响
+    class iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef elemType value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const elemType* pointer;
+        typedef const elemType& reference;
+
+        iterator(): _top(0) {}
+        reference operator*() const { return _stack[_top - 1]->val; }
+        pointer operator->() const { return &_stack[_top - 1]->val; }
+        int count() const { return _stack[_top - 1]->cnt; }
+        iterator& operator++() {
+            Node *node = _stack[--_top];
+            push_left(node->r);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const iterator &rhs) const {
+            return _top == rhs._top && (_top == 0 || _stack[_top - 1] == rhs._stack[_top - 1]);
+        }
+        bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+
+    private:
+        friend class PersistentTree;
+        static const int MAX_DEPTH = 96;
+
+        void push(Node *node) { _stack[_top++] = node; }
+        void push_left(Node *node) {
+            for (; node; node = node->l) push(node);
+        }
+
+        Node *_stack[MAX_DEPTH];
+        int _top;
+    };
+
+private:
+    static int height(const Node *node) { return node ? node->height : 0; }
+    static void update(Node *node) {
+        int lh = height(node->l), rh = height(node->r);
+        node->height = (lh > rh ? lh : rh) + 1;
+    }
+    static void acquire(Node *node) {
+        if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 放弃一个引用，最后一个引用消失时释放节点，并放弃它对子节点的引用
+    static void release(Node *node) {
+        if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            release(node->l);
+            release(node->r);
+            delete node;
+        }
+    }
+    // 拿到一个可以修改的node：独占时就是它自己，被共享时换成一份副本（同时放弃对原节点的引用）。
+    // 沿路径往下时，父节点一旦被复制，子节点的引用计数就至少为2，因此也会被复制，
+    // 不会修改到别的树还能看到的节点
+    static Node* own(Node *node) {
+        if (node->refs.load(std::memory_order_acquire) == 1) return node;
+        Node *copy = new Node(*node);
+        release(node);
+        return copy;
+    }
+
+    // 以下函数的参数node是调用者转交的一个引用，返回值是交回给调用者的新子树根的引用
+    static Node* rotate_right(Node *node) {
+        Node *l = node->l = own(node->l);
+        node->l = l->r;
+        l->r = node;
+        update(node);
+        update(l);
+        return l;
+    }
+    static Node* rotate_left(Node *node) {
+        Node *r = node->r = own(node->r);
+        node->r = r->l;
+        r->l = node;
+        update(node);
+        update(r);
+        return r;
+    }
+    // node已经是独占的，子树已经正确
+    static Node* balance(Node *node) {
+        update(node);
+        int diff = height(node->l) - height(node->r);
+        if (diff > 1) {
+            if (height(node->l->l) < height(node->l->r)) node->l = rotate_left(own(node->l));
+            return rotate_right(node);
+        }
+        if (diff < -1) {
+            if (height(node->r->r) < height(node->r->l)) node->r = rotate_right(own(node->r));
+            return rotate_left(node);
+        }
+        return node;
+    }
+
+    Node* insert(Node *node, const elemType &elem) {
+        if (!node) {
+            _size++;
+            return new Node(elem);
+        }
+        node = own(node);
+        if (_comp(elem, node->val)) node->l = insert(node->l, elem);
+        else if (_comp(node->val, elem)) node->r = insert(node->r, elem);
+        else {
+            node->cnt++;
+            return node;
+        }
+        return balance(node);
+    }
+
+    // 把以node为根的子树中最小的节点摘下来交给min（独占、不再有子节点引用），返回剩下的子树
+    static Node* remove_min(Node *node, Node *&min) {
+        node = own(node);
+        if (!node->l) {
+            Node *r = node->r;
+            node->r = nullptr;
+            min = node;
+            return r;
+        }
+        node->l = remove_min(node->l, min);
+        return balance(node);
+    }
+
+    // elem一定在树中（调用者已经查过），所以路径上的复制都不会白做
+    Node* remove(Node *node, const elemType &elem) {
+        node = own(node);
+        if (_comp(elem, node->val)) node->l = remove(node->l, elem);
+        else if (_comp(node->val, elem)) node->r = remove(node->r, elem);
+        else {
+            Node *l = node->l, *r = node->r;
+            node->l = node->r = nullptr;
+            release(node);
+            if (!l) return r;
+            if (!r) return l;
+            // 以后继取代被删除的节点
+            Node *succ;
+            r = remove_min(r, succ);
+            succ->l = l;
+            succ->r = r;
+            return balance(succ);
+        }
+        return balance(node);
+    }
+
+    template <typename K> Node* find_node(const K &key) const {
+        Node *node = _root;
+        while (node) {
+            if (_comp(key, node->val)) node = node->l;
+            else if (_comp(node->val, key)) node = node->r;
+            else return node;
+        }
+        return nullptr;
+    }
+
+    Node *_root;
+    size_t _size;
+    Compare _comp;
+};
+
+#endif //CODING_PERSISTENTTREE_H
@@ -0,0 +1,284 @@
+#ifndef CODING_TREEFILE_H
+#define CODING_TREEFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FrozenTree.h"
+
+// 二叉搜索树的二进制文件格式（本机字节序）。节点按完全二叉树的层序（即Eytzinger布局，下标从1开始）存放，
+// 读回时沿下标算出中序，O(n)建成完全平衡的树，不必逐个insert。
+//   [0, 64)    Header：魔数、版本、格式、元素大小、对齐、节点数、各区的偏移、文件大小
+// RAW格式（平凡可复制的元素类型）：
+//   [keys_offset, ...)     n + 1个元素，第0个不用（填0），keys_offset按缓存行对齐
+//   [counts_offset, ...)   n + 1个int32，即各节点的_cnt
+//   这正是FrozenTree的内存布局，所以整个文件mmap之后可以直接当作只读树使用（见map_frozen）
+// STRING格式（string）：
+//   [keys_offset, ...)     n条记录，每条为int32的_cnt、uint32的长度和字符串本身
+
+namespace treefile {
+
+const char MAGIC[8] = {'C', 'O', 'D', 'B', 'T', 'R', 'E', 'E'};
+const uint32_t VERSION = 1;
+const uint32_t ALIGNMENT = 64;
+
+enum Format: uint32_t { UNKNOWN = 0, RAW = 1, STRING = 2 };
+
+template <typename T> struct format_of {
+    static const uint32_t value = std::is_trivially_copyable<T>::value ? RAW : UNKNOWN;
+};
+template <> struct format_of<std::string> { static const uint32_t value = STRING; };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint32_t elem_size;         // RAW为sizeof(elemType)，STRING为0
+    uint32_t alignment;
+    uint64_t n;                 // 节点（不同元素）个数
+    uint64_t keys_offset;
+    uint64_t counts_offset;     // 只用于RAW
+    uint64_t file_size;
+    uint64_t reserved;
+};
+static_assert(sizeof(Header) == 64, "treefile::Header must be 64 bytes");
+static_assert(sizeof(int) == sizeof(int32_t), "counts are stored as int32");
+
+inline void fail(const char *what, const char *path) {
+    std::cerr << "TreeFile: " << what << ": " << path << std::endl;
+    std::exit(-1);
+}
+
+inline uint64_t align_up(uint64_t x) { return (x + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+// 带缓冲的顺序写。内容先写进同一目录下的临时文件，close()时fsync，再rename()成目标文件名，
+// 所以目标文件要么是旧的内容，要么是完整的新内容；已经映射了旧文件的读者（map_frozen）看到的是旧的inode，
+// 不受影响。写完必须调用close()：写入失败在那里报告。
+// 没有调用close()就析构（例如栈展开时）只删除临时文件，目标文件保持原样，也不报告错误、不退出程序
+class Writer {
+public:
+    explicit Writer(const char *path): _path(path), _tmp(_path + ".XXXXXX"), _used(0), _buf(1 << 20) {
+        _fd = ::mkstemp(&_tmp[0]);
+        if (_fd < 0) fail("cannot create", _tmp.c_str());
+        // mkstemp建出的文件是0600，改成与普通新文件相同的权限
+        ::fchmod(_fd, 0644);
+    }
+    Writer(const Writer &) = delete;
+    Writer& operator=(const Writer &) = delete;
+    ~Writer() {
+        if (_fd >= 0) {
+            ::close(_fd);
+            ::unlink(_tmp.c_str());
+        }
+    }
+    void close() {
+        flush();
+        int fd = _fd;
+        _fd = -1;
+        if (::fsync(fd) != 0 || ::close(fd) != 0) {
+            ::unlink(_tmp.c_str());
+            fail("cannot write", _tmp.c_str());
+        }
+        if (::rename(_tmp.c_str(), _path.c_str()) != 0) {
+            ::unlink(_tmp.c_str());
+            fail("cannot rename", _path.c_str());
+        }
+    }
+
+    void write(const void *p, size_t bytes) {
+        const char *src = static_cast<const char *>(p);
+        while (bytes > 0) {
+            if (_used == _buf.size()) flush();
+            size_t n = bytes < _buf.size() - _used ? bytes : _buf.size() - _used;
+            std::memcpy(_buf.data() + _used, src, n);
+            _used += n;
+            src += n;
+            bytes -= n;
+        }
+    }
+    void pad(size_t bytes) {
+        static const char zeros[ALIGNMENT] = {};
+        while (bytes > 0) {
+            size_t n = bytes < ALIGNMENT ? bytes : ALIGNMENT;
+            write(zeros, n);
+            bytes -= n;
+        }
+    }
+    void flush() {
+        for (size_t done = 0; done < _used;) {
+            ssize_t n = ::write(_fd, _buf.data() + done, _used - done);
+            if (n <= 0) fail("cannot write", _tmp.c_str());
+            done += size_t(n);
+        }
+        _used = 0;
+    }
+
+private:
+    std::string _path, _tmp;
+    int _fd;
+    size_t _used;
+    std::vector<char> _buf;
+};
+
+// STRING格式中一条记录的内容
+template <typename T> std::pair<const char *, size_t> payload(const T &) { return std::make_pair(nullptr, 0); }
+inline std::pair<const char *, size_t> payload(const std::string &s) { return std::make_pair(s.data(), s.size()); }
+
+// 把n个节点写入文件。at(k)返回Eytzinger下标为k（1 <= k <= n）的节点的(值的地址, 计数)
+template <typename T, typename At>
+void write(const char *path, size_t n, At at) {
+    static_assert(format_of<T>::value != UNKNOWN, "TreeFile supports trivially copyable types and string");
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.format = format_of<T>::value;
+    h.alignment = ALIGNMENT;
+    h.n = n;
+    h.keys_offset = align_up(sizeof(Header));
+    Writer out(path);
+    if (format_of<T>::value == RAW) {
+        h.elem_size = sizeof(T);
+        h.counts_offset = align_up(h.keys_offset + (n + 1) * sizeof(T));
+        h.file_size = h.counts_offset + (n + 1) * sizeof(int32_t);
+        out.write(&h, sizeof(h));
+        out.pad(h.keys_offset - sizeof(h) + sizeof(T));
+        for (size_t k = 1; k <= n; k++) out.write(at(k).first, sizeof(T));
+        out.pad(h.counts_offset - (h.keys_offset + (n + 1) * sizeof(T)) + sizeof(int32_t));
+        for (size_t k = 1; k <= n; k++) {
+            int32_t cnt = at(k).second;
+            out.write(&cnt, sizeof(cnt));
+        }
+    } else {
+        // 文件大小要写完才知道，先算出来
+        h.file_size = h.keys_offset;
+        for (size_t k = 1; k <= n; k++) h.file_size += 2 * sizeof(uint32_t) + payload(*at(k).first).second;
+        out.write(&h, sizeof(h));
+        out.pad(h.keys_offset - sizeof(h));
+        for (size_t k = 1; k <= n; k++) {
+            std::pair<const char *, size_t> p = payload(*at(k).first);
+            int32_t cnt = at(k).second;
+            uint32_t len = uint32_t(p.second);
+            out.write(&cnt, sizeof(cnt));
+            out.write(&len, sizeof(len));
+            out.write(p.first, len);
+        }
+    }
+    out.close();
+}
+
+// 只读地映射整个文件并检查头部。
+// MAP_PRIVATE并不隔离之后对文件的修改：没有被写过的页与文件共享页缓存，原地改写文件，映射里就会看到新内容；
+// 文件被截短后，访问超出新长度的页会收到SIGBUS。保护读者的是Writer：save()从不改写已有的文件，
+// 而是写好一个新文件再rename()过来，映射继续指向旧的inode，直到munmap为止都完整可读。
+// 用其他方式原地截短或改写一个正被映射的文件，仍然会让读者看到半新半旧的内容或者收到SIGBUS
+class Mapping {
+public:
+    explicit Mapping(const char *path, uint32_t format, uint32_t elem_size) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) fail("cannot open", path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header)) fail("truncated header", path);
+        _length = size_t(st.st_size);
+        _base = ::mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, fd, 0);
+        // 文件描述符关闭后映射仍然有效
+        ::close(fd);
+        if (_base == MAP_FAILED) fail("cannot mmap", path);
+        const Header &h = header();
+        if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) fail("not a tree file", path);
+        if (h.version != VERSION) fail("unsupported version", path);
+        if (h.format != format || h.elem_size != elem_size) fail("element type mismatch", path);
+        if (h.file_size > _length || h.keys_offset < sizeof(Header) || h.keys_offset % ALIGNMENT != 0 ||
+            h.keys_offset > h.file_size) fail("corrupt header", path);
+        // 先用文件大小约束n，后面的乘法才不会溢出
+        if (h.n > (h.file_size - h.keys_offset) / (format == RAW ? elem_size : 2 * sizeof(uint32_t))) fail("corrupt header", path);
+        if (format == RAW && (h.counts_offset > h.file_size || h.counts_offset < h.keys_offset + (h.n + 1) * elem_size ||
+                              h.counts_offset + (h.n + 1) * sizeof(int32_t) > h.file_size)) fail("corrupt header", path);
+    }
+    Mapping(const Mapping &) = delete;
+    Mapping& operator=(const Mapping &) = delete;
+    ~Mapping() { ::munmap(_base, _length); }
+
+    const Header& header() const { return *static_cast<const Header *>(_base); }
+    const char* at(uint64_t offset) const { return static_cast<const char *>(_base) + offset; }
+
+private:
+    void *_base;
+    size_t _length;
+};
+
+// 按Eytzinger下标随机访问文件中的节点：value(k)和count(k)，1 <= k <= n()
+template <typename T>
+class Reader {
+public:
+    static_assert(format_of<T>::value != UNKNOWN, "TreeFile supports trivially copyable types and string");
+
+    explicit Reader(const char *path): _map(path, format_of<T>::value, format_of<T>::value == RAW ? sizeof(T) : 0) {
+        const Header &h = _map.header();
+        if (format_of<T>::value == STRING) {
+            // 记录是变长的，先扫一遍记下每条记录的位置。Mapping已经按文件大小检查过n，不会因为损坏的头部申请巨大的内存
+            _offsets.resize(h.n + 1);
+            uint64_t off = h.keys_offset;
+            for (size_t k = 1; k <= h.n; k++) {
+                if (off + 2 * sizeof(uint32_t) > h.file_size) fail("corrupt records", path);
+                _offsets[k] = off;
+                uint32_t len;
+                std::memcpy(&len, _map.at(off + sizeof(int32_t)), sizeof(len));
+                off += 2 * sizeof(uint32_t) + len;
+                if (off > h.file_size) fail("corrupt records", path);
+            }
+        }
+    }
+
+    size_t n() const { return size_t(_map.header().n); }
+    T value(size_t k) const {
+        T val;
+        decode(k, val);
+        return val;
+    }
+    int count(size_t k) const {
+        int32_t cnt;
+        const Header &h = _map.header();
+        std::memcpy(&cnt, format_of<T>::value == RAW ? _map.at(h.counts_offset + k * sizeof(int32_t)) : _map.at(_offsets[k]), sizeof(cnt));
+        return cnt;
+    }
+
+private:
+    template <typename U> void decode(size_t k, U &val) const {
+        std::memcpy(&val, _map.at(_map.header().keys_offset + k * sizeof(U)), sizeof(U));
+    }
+    void decode(size_t k, std::string &val) const {
+        uint32_t len;
+        std::memcpy(&len, _map.at(_offsets[k] + sizeof(int32_t)), sizeof(len));
+        val.assign(_map.at(_offsets[k] + 2 * sizeof(uint32_t)), len);
+    }
+
+    Mapping _map;
+    std::vector<uint64_t> _offsets;
+};
+
+// 把RAW格式的文件直接映射成只读树：不复制、不解析，打开的代价与n无关，
+// 页面在第一次被访问时才从文件读入。映射随返回的FrozenTree一起释放
+template <typename elemType, typename Compare = std::less<> >
+FrozenTree<elemType, Compare> map_frozen(const char *path, const Compare &comp = Compare()) {
+    static_assert(format_of<elemType>::value == RAW, "map_frozen requires a trivially copyable element type");
+    std::shared_ptr<Mapping> map = std::make_shared<Mapping>(path, RAW, sizeof(elemType));
+    const Header &h = map->header();
+    const elemType *keys = reinterpret_cast<const elemType *>(map->at(h.keys_offset));
+    const int *counts = reinterpret_cast<const int *>(map->at(h.counts_offset));
+    return FrozenTree<elemType, Compare>(keys, counts, size_t(h.n), std::move(map), comp);
+}
+
+}
+
+#endif //CODING_TREEFILE_H
@@ -0,0 +1,142 @@
+#ifndef CODING_TREEITERATOR_H
+#define CODING_TREEITERATOR_H
+
+#include <iterator>
+#include <cstddef>
+
+// 二叉树的迭代器。节点带有父指针，所以每一步都只沿着指针上下移动，既不递归，也不需要额外的栈，
+// 不做任何堆分配；树再深也不会栈溢出。Order决定遍历次序（中序、前序、后序），三者都是双向迭代器。
+// 插入不会使迭代器失效（AVL的旋转只改链接，不移动节点）；删除只使指向被删节点的迭代器失效。
+
+// 中序：从小到大
+template <typename Node>
+struct InOrder {
+    static Node* first(Node *root) {
+        if (root) while (root->l_child()) root = root->l_child();
+        return root;
+    }
+    static Node* last(Node *root) {
+        if (root) while (root->r_child()) root = root->r_child();
+        return root;
+    }
+    static Node* next(Node *node) {
+        if (node->r_child()) return first(node->r_child());
+        while (node->parent() && node->parent()->r_child() == node) node = node->parent();
+        return node->parent();
+    }
+    static Node* prev(Node *node) {
+        if (node->l_child()) return last(node->l_child());
+        while (node->parent() && node->parent()->l_child() == node) node = node->parent();
+        return node->parent();
+    }
+};
+
+// 前序：根、左子树、右子树
+template <typename Node>
+struct PreOrder {
+    static Node* first(Node *root) { return root; }
+    // 最后访问的是"能往右就往右，否则往左"一直走到底的叶节点
+    static Node* last(Node *root) {
+        while (root && (root->r_child() || root->l_child())) root = root->r_child() ? root->r_child() : root->l_child();
+        return root;
+    }
+    static Node* next(Node *node) {
+        if (node->l_child()) return node->l_child();
+        if (node->r_child()) return node->r_child();
+        // 向上找到第一个"从左边上来且有右子树"的祖先
+        while (node->parent()) {
+            Node *parent = node->parent();
+            if (parent->l_child() == node && parent->r_child()) return parent->r_child();
+            node = parent;
+        }
+        return nullptr;
+    }
+    static Node* prev(Node *node) {
+        Node *parent = node->parent();
+        if (!parent || parent->l_child() == node || !parent->l_child()) return parent;
+        return last(parent->l_child());
+    }
+};
+
+// 后序：左子树、右子树、根
+template <typename Node>
+struct PostOrder {
+    // 最先访问的是"能往左就往左，否则往右"一直走到底的叶节点
+    static Node* first(Node *root) {
+        while (root && (root->l_child() || root->r_child())) root = root->l_child() ? root->l_child() : root->r_child();
+        return root;
+    }
+    static Node* last(Node *root) { return root; }
+    static Node* next(Node *node) {
+        Node *parent = node->parent();
+        if (parent && parent->l_child() == node && parent->r_child()) return first(parent->r_child());
+        return parent;
+    }
+    static Node* prev(Node *node) {
+        if (node->r_child()) return node->r_child();
+        if (node->l_child()) return node->l_child();
+        // 向上找到第一个"从右边上来且有左子树"的祖先
+        while (node->parent()) {
+            Node *parent = node->parent();
+            if (parent->r_child() == node && parent->l_child()) return parent->l_child();
+            node = parent;
+        }
+        return nullptr;
+    }
+};
+
+// 树中的值不能通过迭代器修改（否则会破坏次序），所以只有const的迭代器。
+// 迭代器记住树的根指针的地址，end()也可以--，得到最后一个元素
+template <typename Node, typename Order>
+class TreeIterator {
+public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef typename Node::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef const value_type& reference;
+
+    TreeIterator(): _node(nullptr), _root(nullptr) {}
+    TreeIterator(Node *node, Node *const *root): _node(node), _root(root) {}
+
+    reference operator*() const { return _node->value(); }
+    pointer operator->() const { return &_node->value(); }
+    // 该值被插入的次数
+    int count() const { return _node->count(); }
+
+    TreeIterator& operator++() {
+        _node = Order::next(_node);
+        return *this;
+    }
+    TreeIterator operator++(int) {
+        TreeIterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+    TreeIterator& operator--() {
+        _node = _node ? Order::prev(_node) : Order::last(*_root);
+        return *this;
+    }
+    TreeIterator operator--(int) {
+        TreeIterator tmp = *this;
+        --*this;
+        return tmp;
+    }
+
+    bool operator==(const TreeIterator &rhs) const { return _node == rhs._node; }
+    bool operator!=(const TreeIterator &rhs) const { return _node != rhs._node; }
+
+private:
+    Node *_node;            // nullptr表示end()
+    Node *const *_root;
+};
+
+// 一对迭代器，可以直接用于range-for
+template <typename Iterator>
+struct TreeRange {
+    Iterator first, last;
+    Iterator begin() const { return first; }
+    Iterator end() const { return last; }
+};
+
+#endif //CODING_TREEITERATOR_H
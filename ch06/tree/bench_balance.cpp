@@ -0,0 +1,52 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include "BinaryTree.h"
+using namespace std;
+
+// 以升序、降序和随机顺序插入n个不同的键，再删除其中一半，比较不平衡的二叉树与AVL树的耗时和树高。
+// 不平衡的树在有序输入下退化成链表，插入是O(n^2)，所以只用前m个键测试。
+// 用法：bench_balance [n=10000000] [m=20000]
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename Balance>
+void bench(const char *policy, const char *order, const vector<int> &keys) {
+    BinaryTree<int, Balance> tree;
+    double t_insert = seconds([&] { for (int k : keys) tree.insert(k); });
+    int h_insert = tree.height();
+    double t_remove = seconds([&] { for (size_t i = 0; i < keys.size(); i += 2) tree.remove(keys[i]); });
+    int h_remove = tree.height();
+    double t_clear = seconds([&] { tree.clear(); });
+    cout << setw(6) << policy << setw(9) << order << setw(10) << keys.size() << fixed << setprecision(1)
+         << "  insert " << setw(8) << t_insert * 1e9 / keys.size() << " ns/key, height " << setw(6) << h_insert
+         << "  remove half " << setw(8) << t_remove * 2e9 / keys.size() << " ns/key, height " << setw(6) << h_remove
+         << "  clear " << setprecision(3) << t_clear << " s" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 10000000;
+    int m = min(n, argc > 2 ? atoi(argv[2]) : 20000);
+    vector<int> sorted(n), reversed(n), shuffled(n);
+    for (int i = 0; i < n; i++) sorted[i] = shuffled[i] = i;
+    reverse_copy(sorted.begin(), sorted.end(), reversed.begin());
+    shuffle(shuffled.begin(), shuffled.end(), mt19937(2021));
+
+    const char *names[] = {"sorted", "reverse", "random"};
+    const vector<int> *orders[] = {&sorted, &reversed, &shuffled};
+    for (int i = 0; i < 3; i++) {
+        vector<int> prefix(orders[i]->begin(), orders[i]->begin() + m);
+        bench<NoBalance>("none", names[i], prefix);
+        bench<AvlBalance>("avl", names[i], prefix);
+        bench<AvlBalance>("avl", names[i], *orders[i]);
+    }
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "BinaryTree.h"
+#include "ConcurrentTree.h"
+using namespace std;
+
+// 读多写少时的吞吐量：ConcurrentTree（读者无锁）对比用一个全局mutex保护的BinaryTree<int, AvlBalance>。
+// 每个线程按给定的比例随机做contains或insert/remove（各一半），键取自[0, 2n)，树中预先放入n个键。
+// 用法：bench_concurrent [n=1000000] [seconds_per_case=1] [max_threads=硬件线程数]
+
+struct LockedTree {
+    BinaryTree<int, AvlBalance> tree;
+    mutable mutex m;
+    void insert(int k) { lock_guard<mutex> lock(m); tree.insert(k); }
+    void remove(int k) { lock_guard<mutex> lock(m); tree.remove(k); }
+    bool contains(int k) const { lock_guard<mutex> lock(m); return tree.contains(k); }
+};
+
+// 返回每秒完成的操作数
+template <typename Tree>
+double run(Tree &tree, int threads, int write_percent, int n, double secs) {
+    atomic<bool> stop(false);
+    atomic<long> total(0);
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(t);
+            long ops = 0, hits = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                unsigned r = gen();
+                int k = int(r % (2u * n));
+                if (int(r >> 16) % 100 < write_percent) {
+                    if (k & 1) tree.insert(k);
+                    else tree.remove(k);
+                } else hits += tree.contains(k);
+                ops++;
+            }
+            total += ops + (hits < 0);
+        });
+    }
+    this_thread::sleep_for(chrono::duration<double>(secs));
+    stop = true;
+    for (thread &th : pool) th.join();
+    return total / secs;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    double secs = argc > 2 ? atof(argv[2]) : 1.0;
+    int max_threads = argc > 3 ? atoi(argv[3]) : int(thread::hardware_concurrency());
+    if (max_threads < 1) max_threads = 1;
+
+    mt19937 gen(2021);
+    vector<int> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = int(gen() % (2u * n));
+
+    // 2的幂个线程，最后总是测一次max_threads个（它不一定是2的幂）
+    vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    for (int write_percent : {1, 10, 50}) {
+        cout << "reads/writes = " << 100 - write_percent << "/" << write_percent << endl;
+        for (int threads : thread_counts) {
+            LockedTree locked;
+            ConcurrentTree<int> concurrent;
+            for (int k : keys) {
+                locked.tree.insert(k);
+                concurrent.insert(k);
+            }
+            double a = run(locked, threads, write_percent, n, secs);
+            double b = run(concurrent, threads, write_percent, n, secs);
+            cout << setw(4) << threads << " threads" << fixed << setprecision(2)
+                 << "  mutex " << setw(8) << a / 1e6 << " Mops/s"
+                 << "  concurrent " << setw(8) << b / 1e6 << " Mops/s"
+                 << "  (x" << b / a << ")" << endl;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "BinaryTree.h"
+using namespace std;
+
+// 对比指针树（AVL）与freeze()得到的Eytzinger快照：随机find/lower_bound的延迟，以及按中序遍历全部元素的耗时。
+// 键取[0, 2n)中的偶数，查询取[0, 2n)中的随机数，所以大约一半命中。
+// 用法：bench_freeze [n=10000000] [queries=10000000]
+
+template <typename Func>
+double seconds(Func f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename Tree>
+void bench(const char *name, const Tree &tree, const vector<int> &queries) {
+    long hits = 0, sum = 0;
+    double t_find = seconds([&] {
+        for (int q : queries) hits += tree.contains(q);
+    });
+    double t_lower = seconds([&] {
+        for (int q : queries) {
+            auto it = tree.lower_bound(q);
+            if (it != tree.end()) sum += *it;
+        }
+    });
+    double t_scan = seconds([&] {
+        for (int x : tree) sum += x;
+    });
+    cout << setw(8) << name << fixed << setprecision(1)
+         << "  contains " << setw(7) << t_find * 1e9 / queries.size() << " ns"
+         << "  lower_bound " << setw(7) << t_lower * 1e9 / queries.size() << " ns"
+         << "  scan " << setprecision(2) << setw(6) << t_scan * 1e9 / tree.size() << " ns/elem"
+         << "  (hits " << hits << ", checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 10000000;
+    int q = argc > 2 ? atoi(argv[2]) : 10000000;
+    vector<int> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = 2 * i;
+    mt19937 gen(2021);
+    shuffle(keys.begin(), keys.end(), gen);
+    vector<int> queries(q);
+    for (int &x : queries) x = int(gen() % (2u * n));
+
+    BinaryTree<int, AvlBalance> tree;
+    double t_build = seconds([&] { for (int k : keys) tree.insert(k); });
+    FrozenTree<int> frozen;
+    double t_freeze = seconds([&] { frozen = tree.freeze(); });
+    cout << "n = " << n << ", height " << tree.height() << fixed << setprecision(3)
+         << ", build " << t_build << " s, freeze " << t_freeze << " s" << endl;
+    bench("pointer", tree, queries);
+    bench("frozen", frozen, queries);
+}
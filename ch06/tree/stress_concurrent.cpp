@@ -0,0 +1,98 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cstdlib>
+#include "ConcurrentTree.h"
+using namespace std;
+
+// ConcurrentTree的压力测试：若干写者不停地插入、删除奇数键，同时若干读者不停地查找、遍历。
+// 偶数键在开始前插入且从不删除，所以读者在任何时刻都必须找到每一个偶数键，
+// 遍历得到的序列必须严格递增、包含全部偶数键；结束时逐个核对每个键的计数。
+// 发现错误时返回非零。建议分别加上-fsanitize=thread和-fsanitize=address编译运行。
+// 用法：stress_concurrent [readers=4] [writers=2] [ops_per_writer=200000]
+
+const int PERMANENT = 2000;     // 偶数键0, 2, ..., 2 * (PERMANENT - 1)
+const int RANGE = 4 * PERMANENT;
+
+int main(int argc, char *argv[]) {
+    int readers = argc > 1 ? atoi(argv[1]) : 4;
+    int writers = argc > 2 ? atoi(argv[2]) : 2;
+    int ops = argc > 3 ? atoi(argv[3]) : 200000;
+
+    ConcurrentTree<int> tree;
+    for (int i = 0; i < PERMANENT; i++) tree.insert(2 * i);
+
+    atomic<bool> done(false);
+    atomic<long> errors(0), reads(0);
+    // 每个写者只碰属于自己的奇数键（k % (2 * writers) == 2 * w + 1），各自记录期望的计数
+    vector<map<int, int> > expected(writers);
+
+    vector<thread> threads;
+    for (int w = 0; w < writers; w++) {
+        threads.emplace_back([&, w] {
+            mt19937 gen(w);
+            map<int, int> &cnt = expected[w];
+            for (int i = 0; i < ops; i++) {
+                int k = int(gen() % (RANGE / (2 * writers))) * 2 * writers + 2 * w + 1;
+                if (gen() % 2) {
+                    tree.insert(k);
+                    cnt[k]++;
+                } else {
+                    tree.remove(k);
+                    // remove()删除整个节点（与BinaryTree一致），计数清零
+                    cnt.erase(k);
+                }
+            }
+        });
+    }
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r] {
+            mt19937 gen(1000 + r);
+            long n = 0;
+            while (!done.load(memory_order_relaxed)) {
+                int k = 2 * int(gen() % PERMANENT);
+                if (!tree.contains(k) || tree.count(k) != 1) errors++;
+                auto view = tree.view();
+                auto it = view.lower_bound(k);
+                if (it == view.end() || *it != k) errors++;
+                if (n % 64 == 0) {
+                    int prev = -1, evens = 0;
+                    for (auto x = view.begin(); x != view.end(); ++x) {
+                        if (*x <= prev) errors++;
+                        evens += *x % 2 == 0;
+                        prev = *x;
+                    }
+                    if (evens != PERMANENT) errors++;
+                }
+                n++;
+            }
+            reads += n;
+        });
+    }
+    for (int w = 0; w < writers; w++) threads[w].join();
+    done = true;
+    for (int r = 0; r < readers; r++) threads[writers + r].join();
+
+    for (int k = 0; k < RANGE; k++) {
+        int want = k % 2 == 0 ? (k < 2 * PERMANENT) : 0;
+        if (k % 2) {
+            const map<int, int> &cnt = expected[(k % (2 * writers)) / 2];
+            auto it = cnt.find(k);
+            if (it != cnt.end()) want = it->second;
+        }
+        if (tree.count(k) != want) {
+            cerr << "key " << k << ": count " << tree.count(k) << ", expected " << want << endl;
+            errors++;
+        }
+    }
+    Epoch::collect();
+    Epoch::collect();
+    Epoch::collect();
+    cout << readers << " readers, " << writers << " writers: " << reads << " reads, "
+         << long(writers) * ops << " writes, " << Epoch::pending() << " nodes pending, "
+         << errors << " errors" << endl;
+    return errors ? 1 : 0;
+}